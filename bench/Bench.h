@@ -0,0 +1,135 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+// Per-operation latency summary, in nanoseconds
+struct BenchResult {
+    string name;
+    uint64_t operations;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+    double max;
+    double opsPerSecond;
+};
+
+// Swallows everything written to it. The library prints on most calls, so
+// benchmarks point cout here: formatting still happens, the terminal does not.
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+class Bench {
+private:
+    vector<BenchResult> results;
+    string filter;
+    double scale;
+
+    static double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[min(index, sorted.size() - 1)];
+    }
+
+public:
+    explicit Bench(string nameFilter = "", double iterationScale = 1.0)
+        : filter(nameFilter), scale(iterationScale) {}
+
+    bool enabled(const string& name) const {
+        return filter.empty() || name.find(filter) != string::npos;
+    }
+
+    // Runs op(i) samples * batch times. Each sample times one batch, so
+    // operations far shorter than a clock read are still measured fairly;
+    // percentiles are over the per-operation time of each sample.
+    template <class Op>
+    void run(const string& name, size_t samples, size_t batch, Op&& op) {
+        measure(name, samples, batch, 1, op);
+    }
+
+    // For an op() that processes `items` operations per call (a whole batch
+    // of orders, say). Each sample is one call; results are per item.
+    template <class Op>
+    void runItems(const string& name, size_t samples, size_t items, Op&& op) {
+        measure(name, samples, 1, items, op);
+    }
+
+private:
+    template <class Op>
+    void measure(const string& name, size_t samples, size_t batch, size_t items, Op& op) {
+        if (!enabled(name)) return;
+        samples = max<size_t>(1, (size_t)(samples * scale));
+        double perSample = (double)batch * items;
+
+        // Warm caches and pools before measuring
+        size_t warmup = min<size_t>(samples / 10 + 1, 1000);
+        uint64_t i = 0;
+        for (size_t s = 0; s < warmup; s++) {
+            for (size_t b = 0; b < batch; b++) op(i++);
+        }
+
+        vector<double> perOp;
+        perOp.reserve(samples);
+        double total = 0.0;
+        for (size_t s = 0; s < samples; s++) {
+            auto start = chrono::steady_clock::now();
+            for (size_t b = 0; b < batch; b++) op(i++);
+            auto end = chrono::steady_clock::now();
+            double ns = chrono::duration<double, nano>(end - start).count();
+            perOp.push_back(ns / perSample);
+            total += ns;
+        }
+        sort(perOp.begin(), perOp.end());
+
+        BenchResult r;
+        r.name = name;
+        r.operations = (uint64_t)(samples * perSample);
+        r.mean = total / r.operations;
+        r.p50 = percentile(perOp, 0.50);
+        r.p90 = percentile(perOp, 0.90);
+        r.p99 = percentile(perOp, 0.99);
+        r.p999 = percentile(perOp, 0.999);
+        r.max = perOp.back();
+        r.opsPerSecond = r.mean > 0 ? 1e9 / r.mean : 0.0;
+        results.push_back(r);
+        cerr << "  " << name << ": " << r.mean << " ns/op\n";
+    }
+
+public:
+    // Records a result measured by the caller (e.g. whole-file throughput)
+    void record(const BenchResult& r) {
+        if (enabled(r.name)) results.push_back(r);
+    }
+
+    const vector<BenchResult>& getResults() const { return results; }
+
+    void writeJson(ostream& out, const vector<pair<string, string>>& context) const {
+        out << "{\n  \"context\": {";
+        for (size_t i = 0; i < context.size(); i++) {
+            out << (i ? ", " : "") << "\"" << context[i].first << "\": \"" << context[i].second << "\"";
+        }
+        out << "},\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            out << "    {\"name\": \"" << r.name << "\", \"operations\": " << r.operations
+                << ", \"ops_per_sec\": " << (uint64_t)r.opsPerSecond
+                << ", \"ns_per_op\": {\"mean\": " << r.mean << ", \"p50\": " << r.p50
+                << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99 << ", \"p999\": " << r.p999
+                << ", \"max\": " << r.max << "}}" << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+    }
+};
+
+#endif
@@ -0,0 +1,837 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "Bench.h"
+#include "../include/User.h"
+#include "../include/Stock.h"
+#include "../include/BuyOrder.h"
+#include "../include/SellOrder.h"
+#include "../include/OrderBook.h"
+#include "../include/OrderIndex.h"
+#include "../include/SymbolTable.h"
+#include "../include/TradeJournal.h"
+#include "../include/Persistence.h"
+#include "../include/MappedFile.h"
+#include "../include/DelimScanner.h"
+#include "../include/Log.h"
+#include "../include/OrderBatch.h"
+#include "../include/ShardedEngine.h"
+#include "../include/RingBuffer.h"
+#include "../include/TradeReplay.h"
+#include "../include/TradeStore.h"
+#include "../include/BarBuilder.h"
+#include "../include/Valuation.h"
+#include "../include/RiskEngine.h"
+#include "../include/UserDirectory.h"
+#include "../include/Snapshot.h"
+#include <thread>
+using namespace std;
+
+namespace fs = std::filesystem;
+
+static const Money RICH = Money::fromUnits(1000000000000000LL);
+
+static vector<SymbolId> makeSymbols(size_t count) {
+    vector<SymbolId> ids;
+    for (size_t i = 0; i < count; i++) {
+        ids.push_back(SymbolTable::intern("SYM" + to_string(i)));
+    }
+    return ids;
+}
+
+static fs::path scratchDir(const string& name) {
+    fs::path dir = fs::temp_directory_path() / "trading_bench" / name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+// BuyOrder::execute / SellOrder::execute, both the direct inventory path and
+// the book path (empty book, so the order trades against inventory)
+static void benchOrders(Bench& bench) {
+    SymbolId sym = SymbolTable::intern("AAPL");
+    Stock stock(sym, Price::fromUnits(15000), 1000000000);
+    User user("bench", RICH);
+    user.buyStock(sym, 1000000000, Price());   // enough that no sell is rejected
+    OrderBook book(sym);
+
+    bench.run("order.buy_execute", 20000, 64, [&](uint64_t) {
+        BuyOrder order(sym, 1, stock.price);
+        order.execute(user, stock);
+    });
+    bench.run("order.sell_execute", 20000, 64, [&](uint64_t) {
+        SellOrder order(sym, 1, stock.price);
+        order.execute(user, stock);
+    });
+    bench.run("order.buy_execute_book", 20000, 64, [&](uint64_t) {
+        BuyOrder order(sym, 1, stock.price);
+        order.execute(user, stock, book);
+    });
+    bench.run("order.sell_execute_book", 20000, 64, [&](uint64_t) {
+        SellOrder order(sym, 1, stock.price);
+        order.execute(user, stock, book);
+    });
+
+    // One resting sell placed and then taken by a buy: rest + match + settlement of both sides
+    User maker("maker", RICH);
+    maker.buyStock(sym, 1000000000, Price::fromUnits(1));
+    bench.run("order.match_resting", 20000, 64, [&](uint64_t) {
+        RiskEngine::reserve(maker, Side::Sell, sym, 1, Price::fromUnits(14900));
+        book.rest(Side::Sell, &maker, 1, Price::fromUnits(14900));
+        BuyOrder order(sym, 1, Price::fromUnits(14900));
+        order.execute(user, stock, book);
+    });
+}
+
+// Cancel traffic against a book holding 10,000 orders over 100 price levels:
+// an order found by id and cancelled (its reservation handed back), then a
+// new one rested so the book stays the same size, and a quantity-down amend
+static void benchCancel(Bench& bench) {
+    if (!bench.enabled("order.cancel") && !bench.enabled("order.reduce")) return;
+    const size_t RESTING = 10000;
+    SymbolId sym = SymbolTable::intern("AAPL");
+    User user("bench", RICH);
+    OrderBook book(sym, RESTING * 2);
+    OrderIndex index;
+    book.setIndex(&index);
+
+    vector<uint64_t> ids(RESTING);
+    auto place = [&](size_t slot, int quantity) {
+        Price price = Price::fromUnits(10000 + (int64_t)(slot % 100));
+        RiskEngine::reserve(user, Side::Buy, sym, quantity, price);
+        ids[slot] = Order::nextId();
+        book.rest(Side::Buy, &user, quantity, price, ids[slot]);
+    };
+    for (size_t i = 0; i < RESTING; i++) place(i, 10);
+
+    bench.run("order.cancel_by_id", 20000, 64, [&](uint64_t i) {
+        size_t slot = (i * 7919) % RESTING;
+        index.cancel(ids[slot]);
+        place(slot, 10);
+    });
+    for (size_t i = 0; i < RESTING; i++) {
+        index.cancel(ids[i]);
+        place(i, 1000000);
+    }
+    bench.run("order.reduce_by_id", 20000, 64, [&](uint64_t i) {
+        size_t slot = (i * 7919) % RESTING;
+        index.reduce(ids[slot], book.restingQuantity(index.find(ids[slot])->handle) - 1);
+    });
+    book.cancelAll([](User*, Side, int, Price) {});
+}
+
+// Aggressive orders: a market buy sweeping ten price levels (the ten asks
+// are rested again each time), and a fill-or-kill buy that cannot fill and
+// is killed by the pre-check without touching the book or the account
+static void benchOrderTypes(Bench& bench) {
+    if (!bench.enabled("order.market") && !bench.enabled("order.fok")) return;
+    SymbolId sym = SymbolTable::intern("AAPL");
+    Stock stock(sym, Price::fromUnits(20000), 0);
+    User taker("taker", RICH);
+    User maker("maker", RICH);
+    maker.buyStock(sym, 1000000000, Price::fromUnits(1));
+    OrderBook book(sym);
+
+    bench.run("order.market_sweep_10", 20000, 16, [&](uint64_t) {
+        for (int level = 0; level < 10; level++) {
+            Price price = Price::fromUnits(10000 + level);
+            RiskEngine::reserve(maker, Side::Sell, sym, 1, price);
+            book.rest(Side::Sell, &maker, 1, price);
+        }
+        BuyOrder order(sym, 10, Price(), OrderType::Market);
+        order.execute(taker, stock, book);
+    });
+
+    for (int level = 0; level < 10; level++) {
+        Price price = Price::fromUnits(10000 + level);
+        RiskEngine::reserve(maker, Side::Sell, sym, 1, price);
+        book.rest(Side::Sell, &maker, 1, price);
+    }
+    bench.run("order.fok_kill", 20000, 64, [&](uint64_t) {
+        BuyOrder order(sym, 11, Price::fromUnits(10009), OrderType::Limit, TimeInForce::FOK);
+        order.execute(taker, stock, book);
+    });
+    book.cancelAll([&](User* owner, Side side, int quantity, Price price) {
+        RiskEngine::release(*owner, side, sym, quantity, price);
+    });
+}
+
+// User::buyStock / sellStock against portfolios of different sizes
+static void benchPortfolio(Bench& bench) {
+    vector<SymbolId> symbols = makeSymbols(1000);
+    Price price = Price::fromUnits(10000);
+
+    for (size_t size : {1, 10, 100, 1000}) {
+        User user("portfolio", RICH);
+        for (size_t i = 0; i < size; i++) {
+            user.buyStock(symbols[i], 1000000, price);
+        }
+        // Spread accesses over the portfolio without a visible pattern
+        vector<SymbolId> picks(4096);
+        mt19937 rng(42);
+        for (auto& p : picks) p = symbols[rng() % size];
+
+        bench.run("user.buy_stock_p" + to_string(size), 20000, 32, [&](uint64_t i) {
+            user.buyStock(picks[i & 4095], 1, price);
+        });
+        bench.run("user.sell_stock_p" + to_string(size), 20000, 32, [&](uint64_t i) {
+            user.sellStock(picks[i & 4095], 1, price);
+        });
+    }
+}
+
+static string userLine(size_t index, size_t holdings) {
+    string line = "user" + to_string(index) + "|10250.75|";
+    for (size_t h = 0; h < holdings; h++) {
+        line += (h ? "," : "") + string("SYM") + to_string(h) + ":" + to_string(10 + h);
+    }
+    return line;
+}
+
+// Stock::loadFromFile / User::loadFromFile per record, and whole-file loads
+// the way main.cpp does them
+static void benchParsing(Bench& bench) {
+    makeSymbols(100);
+    string stockLine = "SYM7|150.25|97";
+    bench.run("parse.stock_line", 20000, 64, [&](uint64_t) {
+        Stock s = Stock::loadFromFile(stockLine);
+        (void)s;
+    });
+    for (size_t holdings : {0, 10, 100}) {
+        string line = userLine(1, holdings);
+        bench.run("parse.user_line_h" + to_string(holdings), 20000, holdings >= 100 ? 4 : 32, [&](uint64_t) {
+            User u = User::loadFromFile(line);
+            (void)u;
+        });
+    }
+
+    if (!bench.enabled("load.users_file_100k")) return;
+    fs::path dir = scratchDir("load");
+    string path = (dir / "users.txt").string();
+    {
+        ofstream file(path);
+        for (size_t i = 0; i < 100000; i++) file << userLine(i, i % 8) << "\n";
+    }
+    bench.run("load.users_file_100k", 20, 1, [&](uint64_t) {
+        UserDirectory loaded;
+        MappedFile users(path);
+        loaded.reserve(DelimScanner::countLines(users.contents()) + 1);
+        DelimScanner::forEachRecord(users.contents(), [&](const DelimRecord& record) {
+            loaded.load(record);
+        });
+    });
+}
+
+// What main.cpp's saveChanges (one trade touching one user and one stock)
+// and saveAllToFiles (exit) cost for different account counts
+static void benchPersistence(Bench& bench) {
+    vector<SymbolId> symbols = makeSymbols(100);
+
+    for (size_t userCount : {1000, 100000}) {
+        string suffix = to_string(userCount / 1000) + "k_users";
+        if (!bench.enabled("persist.save_changes_" + suffix) && !bench.enabled("persist.save_all_" + suffix)) continue;
+
+        fs::path dir = scratchDir("persist_" + suffix);
+        UserDirectory users;
+        vector<Stock*> stocks;
+        users.reserve(userCount);
+        for (size_t i = 0; i < userCount; i++) {
+            users.create("user" + to_string(i), RICH);
+        }
+        for (SymbolId s : symbols) {
+            stocks.push_back(new Stock(s, Price::fromUnits(10000), 1000));
+        }
+        Persistence persistence(dir.string());
+        persistence.compact(users, stocks);
+
+        bench.run("persist.save_changes_" + suffix, 2000, 1, [&](uint64_t i) {
+            users.find((uint32_t)((i * 7919) % users.size()))->addBalance(Money::fromUnits(1));
+            stocks[i % stocks.size()]->markDirty();
+            persistence.flush();
+            if (persistence.needsCompaction(users.size(), stocks.size())) {
+                persistence.compact(users, stocks);
+            }
+        });
+        bench.run("persist.save_all_" + suffix, userCount > 10000 ? 20 : 200, 1, [&](uint64_t) {
+            persistence.compact(users, stocks);
+        });
+
+        for (Stock* s : stocks) delete s;
+    }
+}
+
+// Shutdown and startup with a million accounts holding 0-7 symbols each:
+// writing and reading the binary snapshot, against writing and reading the
+// same accounts as users.txt
+static void benchSnapshot(Bench& bench) {
+    if (!bench.enabled("snapshot.")) return;
+    const size_t USERS = 1000000;
+    vector<SymbolId> symbols = makeSymbols(100);
+    fs::path dir = scratchDir("snapshot");
+    Persistence persistence(dir.string());
+
+    UserDirectory users;
+    vector<Stock*> stocks;
+    string text;
+    for (size_t i = 0; i < USERS; i++) {
+        text += userLine(i, i % 8);
+        text += "\n";
+    }
+    users.reserve(USERS);
+    DelimScanner::forEachRecord(text, [&](const DelimRecord& record) {
+        users.load(record);
+    });
+    for (SymbolId s : symbols) {
+        stocks.push_back(new Stock(s, Price::fromUnits(10000), 1000));
+    }
+
+    bench.runItems("snapshot.save_1m", 5, USERS, [&](uint64_t) {
+        persistence.compact(users, stocks);
+    });
+    bench.runItems("snapshot.load_1m", 5, USERS, [&](uint64_t) {
+        UserDirectory loaded;
+        vector<Stock*> loadedStocks;
+        persistence.loadSnapshot(loaded, loadedStocks);
+        for (Stock* s : loadedStocks) delete s;
+    });
+    bench.runItems("snapshot.export_text_1m", 5, USERS, [&](uint64_t) {
+        persistence.exportText(users, stocks);
+    });
+    bench.runItems("snapshot.load_text_1m", 5, USERS, [&](uint64_t) {
+        UserDirectory loaded;
+        MappedFile file(persistence.usersPath());
+        loaded.reserve(DelimScanner::countLines(file.contents()) + 1);
+        DelimScanner::forEachRecord(file.contents(), [&](const DelimRecord& record) {
+            loaded.load(record);
+        });
+    });
+
+    for (Stock* s : stocks) delete s;
+}
+
+// A million mixed orders executed through the books as heap objects behind
+// Order* and as an OrderBatch of variants stored contiguously. The Order*
+// runs come twice: in allocation order, where the pointer chase mostly hits
+// neighbouring objects, so the gap to the batch is dispatch alone, and in an
+// order unrelated to allocation order, which adds the cache misses of a
+// long-lived heap. Messages are filtered out for the run so the difference
+// is not buried under logging.
+static void benchBatch(Bench& bench) {
+    if (!bench.enabled("batch.")) return;
+    const size_t SYMBOLS = 50, USERS = 1000, ORDERS = 1000000;
+
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    vector<Stock*> stocksBySymbol(SymbolTable::size(), nullptr);
+    vector<OrderBook*> books(SymbolTable::size(), nullptr);
+    for (SymbolId s : symbols) {
+        stocksBySymbol[s] = new Stock(s, Price::fromUnits(10000), 1000000000);
+        books[s] = new OrderBook(s);
+    }
+    vector<User*> users;
+    for (size_t i = 0; i < USERS; i++) {
+        users.push_back(new User("batch" + to_string(i), RICH));
+        for (SymbolId s : symbols) users.back()->buyStock(s, 1000000, Price());
+    }
+
+    LogLevel level = Log::getLevel();
+    Log::setLevel(LogLevel::Warn);
+
+    // Same order stream for both layouts; prices sit at the stock price so
+    // every order trades against inventory and nothing rests
+    mt19937_64 rng(11);
+    OrderBatch batch;
+    batch.reserve(ORDERS);
+    vector<Order*> pointers;
+    vector<User*> owners;
+    pointers.reserve(ORDERS);
+    owners.reserve(ORDERS);
+    for (size_t i = 0; i < ORDERS; i++) {
+        User* user = users[rng() % USERS];
+        SymbolId symbol = symbols[rng() % SYMBOLS];
+        int qty = 1 + (int)(rng() % 10);
+        if (rng() & 1) {
+            batch.addBuy(user, symbol, qty, Price::fromUnits(10000));
+            pointers.push_back(new BuyOrder(symbol, qty, Price::fromUnits(10000)));
+        } else {
+            batch.addSell(user, symbol, qty, Price::fromUnits(10000));
+            pointers.push_back(new SellOrder(symbol, qty, Price::fromUnits(10000)));
+        }
+        owners.push_back(user);
+    }
+    // Long-lived heaps hand out objects in no useful order
+    vector<size_t> visitOrder(ORDERS);
+    for (size_t i = 0; i < ORDERS; i++) visitOrder[i] = i;
+    shuffle(visitOrder.begin(), visitOrder.end(), rng);
+    vector<Order*> shuffled(ORDERS);
+    vector<User*> shuffledOwners(ORDERS);
+    for (size_t i = 0; i < ORDERS; i++) {
+        shuffled[i] = pointers[visitOrder[i]];
+        shuffledOwners[i] = owners[visitOrder[i]];
+    }
+
+    bench.runItems("batch.virtual_in_order_1m", 10, ORDERS, [&](uint64_t) {
+        for (size_t i = 0; i < ORDERS; i++) {
+            Order* order = pointers[i];
+            SymbolId symbol = order->getSymbol();
+            order->execute(*owners[i], *stocksBySymbol[symbol], *books[symbol]);
+        }
+    });
+    bench.runItems("batch.virtual_1m", 10, ORDERS, [&](uint64_t) {
+        for (size_t i = 0; i < ORDERS; i++) {
+            Order* order = shuffled[i];
+            SymbolId symbol = order->getSymbol();
+            order->execute(*shuffledOwners[i], *stocksBySymbol[symbol], *books[symbol]);
+        }
+    });
+    bench.runItems("batch.variant_1m", 10, ORDERS, [&](uint64_t) {
+        batch.execute(stocksBySymbol, books);
+    });
+
+    for (Order* o : pointers) delete o;
+    batch.clear();
+    Log::setLevel(level);
+    for (User* u : users) delete u;
+    for (Stock* s : stocksBySymbol) delete s;
+    for (OrderBook* b : books) delete b;
+}
+
+// Moves a million order-sized messages from producer threads to one
+// consumer that dequeues in batches
+static void benchRing(Bench& bench) {
+    if (!bench.enabled("ring.")) return;
+    const size_t MESSAGES = 1000000, BATCH = 256;
+    const chrono::milliseconds WAIT(1);
+
+    for (WaitStrategy wait : { WaitStrategy::Yield, WaitStrategy::Block }) {
+        string suffix = waitStrategyName(wait);
+
+        SpscRing<EngineOrder> spsc(4096);
+        bench.runItems("ring.spsc_" + suffix, 5, MESSAGES, [&](uint64_t) {
+            thread producer([&] {
+                EngineOrder order = { nullptr, 0, Side::Buy, 1, Price::fromUnits(100), 0 };
+                for (size_t i = 0; i < MESSAGES; ) {
+                    order.quantity = (int)i;
+                    if (spsc.tryPush(order)) i++;
+                    else spsc.waitForSpace(wait, WAIT);
+                }
+            });
+            EngineOrder out[BATCH];
+            for (size_t received = 0; received < MESSAGES; ) {
+                size_t n = spsc.popBatch(out, BATCH);
+                if (n == 0) spsc.waitForItems(wait, WAIT);
+                received += n;
+            }
+            producer.join();
+        });
+
+        MpscRing<EngineOrder> mpsc(4096);
+        bench.runItems("ring.mpsc2_" + suffix, 5, MESSAGES, [&](uint64_t) {
+            vector<thread> producers;
+            for (int p = 0; p < 2; p++) {
+                producers.emplace_back([&] {
+                    EngineOrder order = { nullptr, 0, Side::Sell, 1, Price::fromUnits(100), 0 };
+                    for (size_t i = 0; i < MESSAGES / 2; ) {
+                        if (mpsc.tryPush(order)) i++;
+                        else mpsc.waitForSpace(wait, WAIT);
+                    }
+                });
+            }
+            EngineOrder out[BATCH];
+            for (size_t received = 0; received < MESSAGES; ) {
+                size_t n = mpsc.popBatch(out, BATCH);
+                if (n == 0) mpsc.waitForItems(wait, WAIT);
+                received += n;
+            }
+            for (thread& t : producers) t.join();
+        });
+    }
+}
+
+static void benchEngine(Bench& bench) {
+    if (!bench.enabled("engine.")) return;
+    const size_t SYMBOLS = 64, USERS = 1000, ORDERS = 1000000;
+
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    vector<Stock*> stocks;
+    for (SymbolId s : symbols) {
+        stocks.push_back(new Stock(s, Price::fromUnits(10000), 1000000000));
+    }
+    LogLevel level = Log::getLevel();
+    Log::setLevel(LogLevel::Warn);
+
+    // Every user holds enough of every symbol that no sell is rejected
+    vector<User*> users;
+    for (size_t i = 0; i < USERS; i++) {
+        User* user = new User("engine" + to_string(i), RICH);
+        for (SymbolId s : symbols) user->buyStock(s, 1000000, Price());
+        users.push_back(user);
+    }
+
+    // Limits at the stock price, so orders trade against inventory as in batch.*
+    mt19937_64 rng(13);
+    vector<EngineOrder> orders;
+    orders.reserve(ORDERS);
+    for (size_t i = 0; i < ORDERS; i++) {
+        User* user = users[rng() % USERS];
+        SymbolId symbol = symbols[rng() % SYMBOLS];
+        int qty = 1 + (int)(rng() % 10);
+        Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+        orders.push_back({ user, symbol, side, qty, Price::fromUnits(10000), 0 });
+    }
+
+    for (size_t shards : { 1, 2, 4 }) {
+        ShardedEngine engine(stocks, shards);
+        engine.start();
+        bench.runItems("engine.shards_" + to_string(shards), 5, ORDERS, [&](uint64_t) {
+            for (const EngineOrder& o : orders) {
+                engine.submit(*o.user, o.side, o.symbol, o.quantity, o.limit);
+            }
+            engine.drain();
+        });
+        engine.stop();
+    }
+
+    Log::setLevel(level);
+    for (User* u : users) delete u;
+    for (Stock* s : stocks) delete s;
+}
+
+// Rebuilds 10k users' state from a million lines of trades.txt text
+static void benchReplay(Bench& bench) {
+    if (!bench.enabled("replay.")) return;
+    const size_t LINES = 1000000, USERS = 10000, SYMBOLS = 100;
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    vector<Stock*> stocks;
+    for (SymbolId s : symbols) {
+        stocks.push_back(new Stock(s, Price::fromUnits(10000), 1000));
+    }
+
+    mt19937_64 rng(17);
+    string text;
+    text.reserve(LINES * 40);
+    for (size_t i = 0; i < LINES; i++) {
+        text += (rng() & 1) ? "BUY|trader" : "SELL|trader";
+        text += to_string(rng() % USERS) + "|" + SymbolTable::name(symbols[rng() % SYMBOLS]) + "|";
+        text += to_string(1 + rng() % 100) + "|150.25|2024-02-10\n";
+    }
+    UserDirectory noUsers;
+
+    bench.runItems("replay.text_1m", 5, LINES, [&](uint64_t) {
+        TradeReplay replay;
+        replay.replayText(text);
+        replay.verify(noUsers, stocks);
+    });
+    for (Stock* s : stocks) delete s;
+}
+
+// Analytics kernels over ten million stored trades, reported per row
+static void benchStore(Bench& bench) {
+    if (!bench.enabled("store.")) return;
+    const size_t ROWS = 10000000, SYMBOLS = 100;
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+
+    mt19937_64 rng(19);
+    TradeStore store;
+    store.reserve(ROWS);
+    int64_t start = 1700000000LL * 1000000000LL;
+    for (size_t i = 0; i < ROWS; i++) {
+        store.append(start + (int64_t)i * 1000000, (uint32_t)(rng() % 10000), symbols[rng() % SYMBOLS],
+                     (rng() & 1) ? Side::Sell : Side::Buy, 1 + (int)(rng() % 100), Price::fromUnits(10000 + (int64_t)(rng() % 5000)));
+    }
+    // The middle half of the rows by time
+    TimeRange window = { start + (int64_t)ROWS / 4 * 1000000, start + (int64_t)ROWS / 4 * 3 * 1000000 };
+
+    // The kernels live in another translation unit, so none of these calls
+    // can be optimised away
+    TradeTotals totals;
+    bench.runItems("store.symbol_totals_10m", 10, ROWS, [&](uint64_t i) {
+        totals += store.totals(symbols[i % SYMBOLS], window);
+    });
+    vector<TradeTotals> bySymbol;
+    bench.runItems("store.by_symbol_10m", 10, ROWS, [&](uint64_t) {
+        store.totalsBySymbol(bySymbol, window);
+    });
+    vector<uint32_t> rows;
+    rows.reserve(ROWS);
+    bench.runItems("store.select_range_10m", 10, ROWS, [&](uint64_t) {
+        store.selectRange(window, rows);
+    });
+}
+
+// One trade into the 1s/1m/1h/1d bars of one of 100 symbols, the clock
+// moving 1 ms per trade so bars keep completing into the rings
+static void benchBars(Bench& bench) {
+    if (!bench.enabled("bars.on_trade")) return;
+    const size_t SYMBOLS = 100;
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    BarBuilder bars(SymbolTable::size());
+    int64_t start = 1700000000LL * 1000000000LL;
+    bench.run("bars.on_trade", 20000, 64, [&](uint64_t i) {
+        bars.onTrade(start + (int64_t)i * 1000000, symbols[i % SYMBOLS], 1 + (int)(i & 63),
+                     Price::fromUnits(10000 + (int64_t)(i % 997)));
+    });
+}
+
+// 10,000 accounts holding 10 of 100 symbols each, so about 1,000 holders
+// per symbol: a price tick revalues those and nobody else
+static void benchValuation(Bench& bench) {
+    if (!bench.enabled("valuation.")) return;
+    const size_t USERS = 10000, SYMBOLS = 100, HELD = 10;
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    mt19937_64 rng(23);
+    vector<User> accounts;
+    accounts.reserve(USERS);
+    for (size_t i = 0; i < USERS; i++) {
+        accounts.emplace_back("user" + to_string(i), RICH);
+    }
+
+    Valuation valuation;
+    for (SymbolId s : symbols) valuation.setMark(s, Price::fromUnits(10000));
+    for (User& u : accounts) valuation.track(u);
+    User::setListener(&valuation);
+    for (User& u : accounts) {
+        for (size_t k = 0; k < HELD; k++) {
+            u.buyStock(symbols[rng() % SYMBOLS], 1 + (int)(rng() % 100), Price::fromUnits(9000 + (int64_t)(rng() % 2000)));
+        }
+    }
+
+    bench.run("valuation.price_tick_1k_holders", 20000, 1, [&](uint64_t i) {
+        valuation.onPriceChange(symbols[i % SYMBOLS], Price::fromUnits(9500 + (int64_t)(i % 1000)));
+    });
+    // A buy and then a sell of the same share, so no sale is refused
+    bench.run("valuation.fill", 20000, 64, [&](uint64_t i) {
+        User& u = accounts[(i >> 1) % USERS];
+        SymbolId s = symbols[(i >> 1) % SYMBOLS];
+        if (i & 1) u.sellStock(s, 1, Price::fromUnits(10000));
+        else u.buyStock(s, 1, Price::fromUnits(10000));
+    });
+    Money equity;
+    bench.run("valuation.book_equity", 20000, 64, [&](uint64_t) {
+        equity += valuation.totalEquity();
+    });
+    User::setListener(nullptr);
+}
+
+// The pre-trade check on its own, and a reservation taken and handed back
+// as a resting order does, over accounts holding 10 symbols each
+static void benchRisk(Bench& bench) {
+    if (!bench.enabled("risk.")) return;
+    const size_t USERS = 1000, SYMBOLS = 100, HELD = 10;
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    mt19937_64 rng(29);
+    vector<User> accounts;
+    accounts.reserve(USERS);
+    vector<SymbolId> held;
+    for (size_t i = 0; i < USERS; i++) {
+        accounts.emplace_back("risk" + to_string(i), Money::fromUnits(100000000));
+        for (size_t k = 0; k < HELD; k++) {
+            held.push_back(symbols[rng() % SYMBOLS]);
+            accounts.back().buyStock(held.back(), 1000, Price());
+        }
+    }
+    LogLevel level = Log::getLevel();
+    Log::setLevel(LogLevel::Warn);
+
+    uint64_t accepted = 0;
+    bench.run("risk.check", 20000, 64, [&](uint64_t i) {
+        size_t a = (i * 7919) % USERS;
+        Side side = (i & 1) ? Side::Sell : Side::Buy;
+        accepted += RiskEngine::check(accounts[a], side, held[a * HELD + (i % HELD)], 1 + (int)(i & 15),
+                                      Price::fromUnits(10000)) == RiskReject::None;
+    });
+    bench.run("risk.reserve_release", 20000, 64, [&](uint64_t i) {
+        size_t a = (i * 7919) % USERS;
+        Side side = (i & 1) ? Side::Sell : Side::Buy;
+        SymbolId s = held[a * HELD + (i % HELD)];
+        if (RiskEngine::reserve(accounts[a], side, s, 1, Price::fromUnits(10000)) == RiskReject::None) {
+            RiskEngine::release(accounts[a], side, s, 1, Price::fromUnits(10000));
+        }
+    });
+    Log::setLevel(level);
+}
+
+// A million accounts in the directory: adding them, finding one by name
+// (as loading trades.txt does per line) or by id (as exporting the journal
+// does), and a pass over all of them as a batch job makes
+static void benchDirectory(Bench& bench) {
+    if (!bench.enabled("users.")) return;
+    const size_t USERS = 1000000;
+    vector<string> names;
+    names.reserve(USERS);
+    for (size_t i = 0; i < USERS; i++) {
+        names.push_back("account" + to_string(i));
+    }
+    LogLevel level = Log::getLevel();
+    Log::setLevel(LogLevel::Warn);
+
+    UserDirectory users;
+    bench.runItems("users.create_1m", 3, USERS, [&](uint64_t) {
+        users.clear();
+        for (const string& name : names) users.create(name, RICH);
+    });
+    uint64_t found = 0;
+    bench.run("users.find_name_1m", 20000, 64, [&](uint64_t i) {
+        found += users.find(names[(i * 7919) % USERS]) != nullptr;
+    });
+    bench.run("users.find_id_1m", 20000, 64, [&](uint64_t i) {
+        found += users.find((uint32_t)((i * 7919) % USERS)) != nullptr;
+    });
+    Money total;
+    bench.runItems("users.for_each_1m", 20, USERS, [&](uint64_t) {
+        users.forEach([&](uint32_t, const User& u) { total += u.getBalance(); });
+    });
+    users.clear();
+    Log::setLevel(level);
+}
+
+static void benchJournal(Bench& bench) {
+    if (!bench.enabled("journal.append")) return;
+    fs::path dir = scratchDir("journal");
+    TradeJournal journal(dir.string());
+    journal.open();
+    SymbolId sym = SymbolTable::intern("AAPL");
+    vector<string> names;
+    for (size_t i = 0; i < 1024; i++) names.push_back("trader" + to_string(i));
+    bench.run("journal.append", 50000, 64, [&](uint64_t i) {
+        uint32_t user = (uint32_t)(i & 1023);
+        journal.append(user, names[user], sym, (i & 1) ? Side::Sell : Side::Buy, 10, Price::fromUnits(15000));
+    });
+    journal.close();
+}
+
+// Random limit orders from many users across many symbols, executed through
+// the books with journalling, as the menu does it minus the prompts
+static void benchEndToEnd(Bench& bench) {
+    if (!bench.enabled("e2e.order_flow")) return;
+    const size_t SYMBOLS = 50, USERS = 1000, PATTERN = 1 << 16;
+
+    vector<SymbolId> symbols = makeSymbols(SYMBOLS);
+    vector<Stock*> stocks;
+    vector<OrderBook*> books(SymbolTable::size(), nullptr);
+    for (SymbolId s : symbols) {
+        stocks.push_back(new Stock(s, Price::fromUnits(10000), 1000000000));
+        books[s] = new OrderBook(s);
+    }
+    vector<User*> users;
+    for (size_t i = 0; i < USERS; i++) {
+        users.push_back(new User("trader" + to_string(i), RICH));
+        for (SymbolId s : symbols) users.back()->buyStock(s, 1000000, Price());
+    }
+
+    struct Flow { uint32_t user; uint32_t stock; bool buy; int qty; Price price; };
+    vector<Flow> flow(PATTERN);
+    mt19937_64 rng(7);
+    for (Flow& f : flow) {
+        f.user = (uint32_t)(rng() % USERS);
+        f.stock = (uint32_t)(rng() % SYMBOLS);
+        f.buy = rng() & 1;
+        f.qty = 1 + (int)(rng() % 100);
+        f.price = Price::fromUnits(10000 + (int64_t)(rng() % 21) - 10);
+    }
+
+    fs::path dir = scratchDir("e2e");
+    TradeJournal journal(dir.string());
+    journal.open();
+
+    // Both sides of every fill are journalled as it happens, as the menu does
+    struct Recorder : TradeListener {
+        TradeJournal& journal;
+        unordered_map<const User*, uint32_t> ids;
+        explicit Recorder(TradeJournal& j) : journal(j) {}
+        void onTrade(User& user, Side side, SymbolId symbol, int quantity, Price price, uint64_t, bool maker) override {
+            journal.append(ids[&user], user.getName(), symbol, side, quantity, price, maker);
+        }
+    } recorder(journal);
+    for (uint32_t id = 0; id < users.size(); id++) recorder.ids[users[id]] = id;
+    TradeListener* previous = Order::setTradeListener(&recorder);
+
+    bench.run("e2e.order_flow", 20000, 64, [&](uint64_t i) {
+        const Flow& f = flow[i & (PATTERN - 1)];
+        Stock& stock = *stocks[f.stock];
+        OrderBook& book = *books[stock.symbol];
+        if (f.buy) {
+            BuyOrder order(stock.symbol, f.qty, f.price);
+            order.execute(*users[f.user], stock, book);
+        } else {
+            SellOrder order(stock.symbol, f.qty, f.price);
+            order.execute(*users[f.user], stock, book);
+        }
+    });
+
+    Order::setTradeListener(previous);
+    journal.close();
+    for (User* u : users) delete u;
+    for (Stock* s : stocks) delete s;
+    for (OrderBook* b : books) delete b;
+}
+
+int main(int argc, char* argv[]) {
+    string filter;
+    string outPath;
+    double scale = 1.0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--out" && i + 1 < argc) outPath = argv[++i];
+        else if (arg == "--quick") scale = 0.1;
+        else {
+            cerr << "Usage: " << argv[0] << " [--filter substring] [--out results.json] [--quick]\n";
+            return 1;
+        }
+    }
+
+    // Library messages go through the async log as they do in the app; the
+    // writer formats them into a sink. Direct cout output is dropped as well.
+    NullBuffer sink;
+    ostream discard(&sink);
+    streambuf* console = cout.rdbuf(&sink);
+    Log::start(discard);
+
+    Bench bench(filter, scale);
+    cerr << "Running benchmarks...\n";
+    benchOrders(bench);
+    benchCancel(bench);
+    benchOrderTypes(bench);
+    benchPortfolio(bench);
+    benchParsing(bench);
+    benchPersistence(bench);
+    benchSnapshot(bench);
+    benchBatch(bench);
+    benchRing(bench);
+    benchEngine(bench);
+    benchJournal(bench);
+    benchReplay(bench);
+    benchStore(bench);
+    benchBars(bench);
+    benchValuation(bench);
+    benchRisk(bench);
+    benchDirectory(bench);
+    benchEndToEnd(bench);
+    fs::remove_all(fs::temp_directory_path() / "trading_bench");
+
+    Log::stop();
+    cout.rdbuf(console);
+    vector<pair<string, string>> context = {
+        {"scanner", DelimScanner::implementation()},
+        {"scale", to_string(scale)}
+    };
+    if (outPath.empty()) {
+        bench.writeJson(cout, context);
+    } else {
+        ofstream out(outPath);
+        if (!out.is_open()) {
+            cerr << "Could not open " << outPath << "\n";
+            return 1;
+        }
+        bench.writeJson(out, context);
+        cerr << "Results written to " << outPath << "\n";
+    }
+    return 0;
+}
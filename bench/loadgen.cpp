@@ -0,0 +1,434 @@
+// Synthetic order flow for capacity planning.
+//
+// Creates N users and M stocks, generates an order stream up front and then
+// replays it against the books in real time, either on this thread as the
+// menu trades (--shards 0) or through a ShardedEngine. The stream has:
+//  - Zipf-distributed symbol popularity: symbol k is chosen with weight 1/k^s
+//  - bursty arrivals: a Poisson process that switches between a calm rate
+//    and a burst rate --burst times higher, averaging --rate orders/s
+//  - a --buy share of buys; sells are for symbols the user holds
+//  - limits a geometric number of ticks from the stock price, through it
+//    for the --marketable share and away from it (resting) for the rest
+//
+// Latency is measured from each order's scheduled arrival to the moment its
+// result is settled on the account, so time spent queued behind a burst
+// counts. With --rate 0 orders arrive as fast as they are taken and latency
+// is the service time alone. The summary goes to stderr and the results to
+// stdout as JSON, in the format trading_bench writes.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include "Bench.h"
+#include "../include/User.h"
+#include "../include/UserDirectory.h"
+#include "../include/Stock.h"
+#include "../include/BuyOrder.h"
+#include "../include/SellOrder.h"
+#include "../include/OrderBook.h"
+#include "../include/ShardedEngine.h"
+#include "../include/SymbolTable.h"
+#include "../include/Log.h"
+using namespace std;
+
+struct LoadConfig {
+    size_t users = 10000;
+    size_t symbols = 500;
+    size_t orders = 200000;
+    double rate = 100000;          // orders per second on average, 0 for flat out
+    size_t shards = 0;             // 0 trades on this thread through the books
+    double zipf = 1.0;
+    double burst = 8;              // rate multiplier while bursting
+    double burstShare = 0.1;       // share of time spent bursting
+    double burstMs = 20;           // mean burst length
+    double buyShare = 0.5;
+    double marketable = 0.3;       // share of orders priced through the stock price
+    double depth = 10;             // mean ticks between limit and stock price
+    double quantity = 20;          // mean order size
+    size_t holdings = 8;           // symbols each user starts out holding
+    size_t bookSize = OrderBook::DEFAULT_MAX_ORDERS;
+    uint64_t seed = 1;
+    string out;
+};
+
+struct LoadOrder {
+    int64_t at;            // scheduled arrival, ns after the start
+    uint32_t user;
+    uint32_t stock;        // index into the stocks
+    Side side;
+    int quantity;
+    Price limit;
+};
+
+struct LoadCounts {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t filled = 0;       // orders that traded at least in part (direct path)
+    uint64_t rested = 0;       // orders left resting on a book (direct path)
+};
+
+static const Money USER_CASH = Money::fromUnits(100000000000LL);
+static const int HOLDING = 1000000;
+
+// Symbol k (0-based) is picked with weight 1 / (k + 1)^s
+static discrete_distribution<size_t> zipf(size_t count, double s) {
+    vector<double> weights(count);
+    for (size_t k = 0; k < count; k++) weights[k] = 1.0 / pow((double)(k + 1), s);
+    return discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+// Arrival times of a Poisson process switching between a calm and a burst
+// rate, with exponentially distributed periods in each state
+static void scheduleArrivals(const LoadConfig& config, mt19937_64& rng, vector<LoadOrder>& orders) {
+    if (config.rate <= 0) return;
+    double calmRate = config.rate / (1 - config.burstShare + config.burstShare * config.burst);
+    double burstNs = config.burstMs * 1e6;
+    double calmNs = config.burstShare > 0 ? burstNs * (1 - config.burstShare) / config.burstShare : 1e30;
+    exponential_distribution<double> unit(1.0);
+
+    bool bursting = false;
+    double t = 0;
+    double switchAt = unit(rng) * calmNs;
+    for (LoadOrder& o : orders) {
+        while (true) {
+            double rate = (bursting ? calmRate * config.burst : calmRate) / 1e9;
+            double next = t + unit(rng) / rate;
+            if (next < switchAt) {
+                t = next;
+                break;
+            }
+            // Memoryless, so the draw can restart at the switch
+            t = switchAt;
+            bursting = !bursting;
+            switchAt = t + unit(rng) * (bursting ? burstNs : calmNs);
+        }
+        o.at = (int64_t)t;
+    }
+}
+
+static vector<LoadOrder> generate(const LoadConfig& config, const vector<Stock*>& stocks,
+                                  const vector<vector<uint32_t>>& held, mt19937_64& rng) {
+    discrete_distribution<size_t> popular = zipf(stocks.size(), config.zipf);
+    uniform_int_distribution<uint32_t> anyUser(0, (uint32_t)config.users - 1);
+    bernoulli_distribution isBuy(config.buyShare);
+    bernoulli_distribution isMarketable(config.marketable);
+    geometric_distribution<int> size(1.0 / max(config.quantity, 1.0));
+    geometric_distribution<int> ticks(1.0 / (config.depth + 1));
+
+    vector<LoadOrder> orders(config.orders);
+    for (LoadOrder& o : orders) {
+        o.at = 0;
+        o.user = anyUser(rng);
+        o.side = isBuy(rng) ? Side::Buy : Side::Sell;
+        if (o.side == Side::Buy) {
+            o.stock = (uint32_t)popular(rng);
+        } else {
+            const vector<uint32_t>& mine = held[o.user];
+            o.stock = mine[rng() % mine.size()];
+        }
+        o.quantity = 1 + size(rng);
+
+        Price reference = stocks[o.stock]->price;
+        Price offset = Price::fromUnits(1 + ticks(rng));
+        // A buy goes through the price by bidding above it, a sell by asking below
+        bool above = (o.side == Side::Buy) == isMarketable(rng);
+        o.limit = above ? reference + offset : reference - offset;
+        if (o.limit < Price::fromUnits(1)) o.limit = Price::fromUnits(1);
+    }
+    scheduleArrivals(config, rng, orders);
+    return orders;
+}
+
+// Sleeps until close to ns after start, then spins the rest of the way
+static int64_t waitUntil(chrono::steady_clock::time_point start, int64_t ns) {
+    while (true) {
+        int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        int64_t left = ns - now;
+        if (left <= 0) return now;
+        if (left > 200000) this_thread::sleep_for(chrono::nanoseconds(left - 100000));
+        else this_thread::yield();
+    }
+}
+
+static int64_t elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+// One order at a time through the books, as buyStocks/sellStocks do it
+static void runDirect(const LoadConfig& config, const vector<LoadOrder>& orders, UserDirectory& users,
+                      vector<Stock*>& stocks, vector<double>& latencies, LoadCounts& counts, double& seconds) {
+    vector<OrderBook*> books;   // parallel to stocks
+    for (Stock* s : stocks) books.push_back(new OrderBook(s->symbol, config.bookSize));
+
+    auto start = chrono::steady_clock::now();
+    for (const LoadOrder& o : orders) {
+        int64_t from = config.rate > 0 ? o.at : elapsedNs(start);
+        if (config.rate > 0) waitUntil(start, o.at);
+
+        User& user = *users.find(o.user);
+        Stock& stock = *stocks[o.stock];
+        OrderBook& book = *books[o.stock];
+        bool ok;
+        int filled;
+        bool resting;
+        if (o.side == Side::Buy) {
+            BuyOrder order(stock.symbol, o.quantity, o.limit);
+            ok = order.execute(user, stock, book);
+            filled = order.getFilledQuantity();
+            resting = order.isResting();
+        } else {
+            SellOrder order(stock.symbol, o.quantity, o.limit);
+            ok = order.execute(user, stock, book);
+            filled = order.getFilledQuantity();
+            resting = order.isResting();
+        }
+        latencies.push_back((double)(elapsedNs(start) - from));
+
+        if (!ok) {
+            counts.rejected++;
+            continue;
+        }
+        counts.accepted++;
+        if (filled > 0) counts.filled++;
+        if (resting) counts.rested++;
+    }
+    seconds = elapsedNs(start) / 1e9;
+
+    // Hand the resting orders' reservations back
+    for (OrderBook* book : books) {
+        SymbolId symbol = book->getSymbol();
+        book->cancelAll([&](User* owner, Side side, int quantity, Price price) {
+            if (owner) RiskEngine::release(*owner, side, symbol, quantity, price);
+        });
+        delete book;
+    }
+}
+
+// Orders that have arrived are submitted together, then drained: an order's
+// latency runs to the end of the drain that settles it
+static void runEngine(const LoadConfig& config, const vector<LoadOrder>& orders, UserDirectory& users,
+                      vector<Stock*>& stocks, vector<double>& latencies, LoadCounts& counts,
+                      uint64_t& fillEvents, double& seconds) {
+    const size_t WINDOW = 4096;
+    ShardedEngine engine(stocks, config.shards, config.bookSize);
+    engine.start();
+
+    vector<int64_t> due;
+    due.reserve(WINDOW);
+    auto start = chrono::steady_clock::now();
+    size_t next = 0;
+    while (next < orders.size()) {
+        int64_t now = config.rate > 0 ? waitUntil(start, orders[next].at) : elapsedNs(start);
+        due.clear();
+        while (next < orders.size() && due.size() < WINDOW && orders[next].at <= now) {
+            const LoadOrder& o = orders[next++];
+            int64_t from = config.rate > 0 ? o.at : elapsedNs(start);
+            if (engine.submit(*users.find(o.user), o.side, stocks[o.stock]->symbol, o.quantity, o.limit)) {
+                counts.accepted++;
+            } else {
+                counts.rejected++;
+            }
+            due.push_back(from);
+        }
+        engine.drain();
+        int64_t done = elapsedNs(start);
+        for (int64_t from : due) latencies.push_back((double)(done - from));
+    }
+    seconds = elapsedNs(start) / 1e9;
+    fillEvents = engine.fillCount();
+    engine.stop();
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+static void usage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "  --users N          accounts to create (10000)\n"
+         << "  --symbols N        stocks to create (500)\n"
+         << "  --orders N         orders to send (200000)\n"
+         << "  --rate R           average orders per second, 0 for as fast as possible (100000)\n"
+         << "  --shards N         engine shards, 0 to trade on one thread as the menu does (0)\n"
+         << "  --zipf S           symbol popularity exponent (1.0)\n"
+         << "  --burst X          rate multiplier during bursts (8)\n"
+         << "  --burst-share F    share of time in bursts (0.1)\n"
+         << "  --burst-ms MS      mean burst length (20)\n"
+         << "  --buy F            share of buy orders (0.5)\n"
+         << "  --marketable F     share of orders priced through the stock price (0.3)\n"
+         << "  --depth TICKS      mean distance of limits from the stock price (10)\n"
+         << "  --qty N            mean order size (20)\n"
+         << "  --holdings N       symbols each user starts out holding (8)\n"
+         << "  --book-size N      resting orders per book (" << OrderBook::DEFAULT_MAX_ORDERS << ")\n"
+         << "  --seed N           random seed (1)\n"
+         << "  --out FILE         write the JSON results to FILE instead of stdout\n";
+}
+
+static LoadConfig parseArgs(int argc, char* argv[]) {
+    LoadConfig c;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) throw invalid_argument("Missing value for " + arg);
+        string value = argv[++i];
+        if (arg == "--users") c.users = stoull(value);
+        else if (arg == "--symbols") c.symbols = stoull(value);
+        else if (arg == "--orders") c.orders = stoull(value);
+        else if (arg == "--rate") c.rate = stod(value);
+        else if (arg == "--shards") c.shards = stoull(value);
+        else if (arg == "--zipf") c.zipf = stod(value);
+        else if (arg == "--burst") c.burst = stod(value);
+        else if (arg == "--burst-share") c.burstShare = stod(value);
+        else if (arg == "--burst-ms") c.burstMs = stod(value);
+        else if (arg == "--buy") c.buyShare = stod(value);
+        else if (arg == "--marketable") c.marketable = stod(value);
+        else if (arg == "--depth") c.depth = stod(value);
+        else if (arg == "--qty") c.quantity = stod(value);
+        else if (arg == "--holdings") c.holdings = stoull(value);
+        else if (arg == "--book-size") c.bookSize = stoull(value);
+        else if (arg == "--seed") c.seed = stoull(value);
+        else if (arg == "--out") c.out = value;
+        else throw invalid_argument("Unknown option " + arg);
+    }
+    if (c.users == 0 || c.symbols == 0 || c.orders == 0 || c.holdings == 0 || c.bookSize == 0) {
+        throw invalid_argument("Counts must be at least 1");
+    }
+    if (c.rate < 0 || c.burst < 1 || c.burstShare < 0 || c.burstShare >= 1 || c.burstMs <= 0 || c.depth < 0) {
+        throw invalid_argument("Rates, bursts and depth out of range");
+    }
+    if (c.buyShare < 0 || c.buyShare > 1 || c.marketable < 0 || c.marketable > 1) {
+        throw invalid_argument("Shares must be between 0 and 1");
+    }
+    return c;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 2 && string(argv[1]) == "--help") {
+        usage(argv[0]);
+        return 0;
+    }
+    LoadConfig config;
+    try {
+        config = parseArgs(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << "\n";
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Fills and rejections are counted here, not printed
+    NullBuffer sink;
+    ostream discard(&sink);
+    streambuf* console = cout.rdbuf(&sink);
+    Log::start(discard);
+    Log::setLevel(LogLevel::Off);
+
+    mt19937_64 rng(config.seed);
+    vector<Stock*> stocks;
+    for (size_t i = 0; i < config.symbols; i++) {
+        Price price = Price::fromUnits(1000 + (int64_t)(rng() % 49000));
+        stocks.push_back(new Stock(SymbolTable::intern("LOAD" + to_string(i)), price, 1000000000));
+    }
+    // Popular symbols are also the widely held ones
+    discrete_distribution<size_t> popular = zipf(config.symbols, config.zipf);
+
+    UserDirectory users;
+    users.reserve(config.users);
+    vector<vector<uint32_t>> held(config.users);   // stock indices
+    for (size_t i = 0; i < config.users; i++) {
+        User& user = *users.get(users.create("load" + to_string(i), USER_CASH));
+        for (size_t k = 0; k < config.holdings; k++) {
+            uint32_t stock = (uint32_t)popular(rng);
+            user.buyStock(stocks[stock]->symbol, HOLDING, Price());
+            held[i].push_back(stock);
+        }
+    }
+    User::clearDirtyUsers();
+    Stock::clearDirtyStocks();
+
+    vector<LoadOrder> orders = generate(config, stocks, held, rng);
+    cerr << "Generated " << orders.size() << " orders for " << config.users << " users over "
+         << config.symbols << " symbols (zipf " << config.zipf << ")\n";
+    if (config.rate > 0) {
+        cerr << "Arrivals: " << config.rate << "/s on average, bursts of x" << config.burst << " for "
+             << config.burstShare * 100 << "% of the time, " << config.burstMs << " ms each on average\n";
+    }
+
+    vector<double> latencies;
+    latencies.reserve(orders.size());
+    LoadCounts counts;
+    uint64_t fillEvents = 0;
+    double seconds = 0;
+    if (config.shards == 0) {
+        runDirect(config, orders, users, stocks, latencies, counts, seconds);
+    } else {
+        runEngine(config, orders, users, stocks, latencies, counts, fillEvents, seconds);
+    }
+
+    double total = 0;
+    for (double ns : latencies) total += ns;
+    sort(latencies.begin(), latencies.end());
+    BenchResult r;
+    r.name = config.shards == 0 ? "loadgen.direct" : "loadgen.shards_" + to_string(config.shards);
+    r.operations = latencies.size();
+    r.mean = latencies.empty() ? 0.0 : total / latencies.size();
+    r.p50 = percentile(latencies, 0.50);
+    r.p90 = percentile(latencies, 0.90);
+    r.p99 = percentile(latencies, 0.99);
+    r.p999 = percentile(latencies, 0.999);
+    r.max = latencies.empty() ? 0.0 : latencies.back();
+    r.opsPerSecond = seconds > 0 ? latencies.size() / seconds : 0.0;
+
+    cerr << "Ran in " << seconds << " s: " << (uint64_t)r.opsPerSecond << " orders/s";
+    // The schedule's own rate, which bursts move away from --rate over a short run
+    if (config.rate > 0 && orders.back().at > 0) {
+        cerr << " (offered " << (uint64_t)(orders.size() / (orders.back().at / 1e9)) << ")";
+    }
+    cerr << "\nAccepted " << counts.accepted << ", rejected " << counts.rejected;
+    if (config.shards == 0) {
+        cerr << "; " << counts.filled << " traded, " << counts.rested << " left resting\n";
+    } else {
+        cerr << "; " << fillEvents << " fill events settled\n";
+    }
+    cerr << "Latency from arrival (us): mean " << r.mean / 1000 << ", p50 " << r.p50 / 1000 << ", p90 "
+         << r.p90 / 1000 << ", p99 " << r.p99 / 1000 << ", p99.9 " << r.p999 / 1000 << ", max " << r.max / 1000 << "\n";
+
+    Bench bench;
+    bench.record(r);
+    vector<pair<string, string>> context = {
+        {"users", to_string(config.users)},
+        {"symbols", to_string(config.symbols)},
+        {"orders", to_string(config.orders)},
+        {"rate", to_string(config.rate)},
+        {"shards", to_string(config.shards)},
+        {"zipf", to_string(config.zipf)},
+        {"burst", to_string(config.burst)},
+        {"burst_share", to_string(config.burstShare)},
+        {"buy_share", to_string(config.buyShare)},
+        {"marketable", to_string(config.marketable)},
+        {"accepted", to_string(counts.accepted)},
+        {"rejected", to_string(counts.rejected)},
+        {"seconds", to_string(seconds)}
+    };
+
+    Log::stop();
+    cout.rdbuf(console);
+    for (Stock* s : stocks) delete s;
+    if (config.out.empty()) {
+        bench.writeJson(cout, context);
+    } else {
+        ofstream out(config.out);
+        if (!out.is_open()) {
+            cerr << "Could not open " << config.out << " for writing\n";
+            return 1;
+        }
+        bench.writeJson(out, context);
+    }
+    return 0;
+}
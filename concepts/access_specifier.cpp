@@ -63,11 +63,11 @@ void accessDemo() {
     cout << u.getName() << endl;
     cout << u.getBalance() << endl;
 
-    u.addBalance(1000); // modifying private data
+    u.addBalance(Money::fromDouble(1000)); // modifying private data
 
     // protected used inside derived class
     Stock s("AAPL", 150, 100);
-    BuyOrder b("AAPL", 2, 150);
+    BuyOrder b("AAPL", 2, Price::fromDouble(150));
 
     b.execute(u, s); // uses protected members internally
 }
@@ -23,12 +23,12 @@ using namespace std;
 
 // copy passed
 void valueDemo(User u) {
-    u.addBalance(1000); // change only in copy
+    u.addBalance(Money::fromDouble(1000)); // change only in copy
 }
 
 // original passed
 void referenceDemo(User& u) {
-    u.addBalance(1000); // change in original
+    u.addBalance(Money::fromDouble(1000)); // change in original
 }
 
 // returning reference
@@ -50,7 +50,7 @@ void callDemo() {
     referenceDemo(u); // original modified
     cout << "After Reference: " << u.getBalance() << endl;
 
-    returnReference(u).addBalance(2000); // chaining
+    returnReference(u).addBalance(Money::fromDouble(2000)); // chaining
     cout << "After Return Reference: " << u.getBalance() << endl;
 }
 
@@ -61,7 +61,7 @@ void tradingDemo() {
     User u("Amit", 10000);
     Stock s("AAPL", 150, 100);
 
-    BuyOrder order("AAPL", 5, 150);
+    BuyOrder order("AAPL", 5, Price::fromDouble(150));
 
     order.execute(u, s); 
     // reference used → original objects modified
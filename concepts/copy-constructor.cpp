@@ -40,7 +40,7 @@ void copyDemo() {
     cout << "\nCopied:\n";
     cout << u2.getName() << " - " << u2.getBalance() << endl;
 
-    u2.addBalance(2000); // modify copy
+    u2.addBalance(Money::fromDouble(2000)); // modify copy
 
     cout << "\nAfter Change:\n";
     cout << "Original: " << u1.getBalance() << endl;
@@ -81,7 +81,7 @@ void tradingDemo() {
     User* u = new User("Rahul", 10000);
     Stock* s = new Stock("AAPL", 150, 100);
 
-    BuyOrder* order = new BuyOrder("AAPL", 3, 150);
+    BuyOrder* order = new BuyOrder("AAPL", 3, Price::fromDouble(150));
 
     order->execute(*u, *s); // reference use
 
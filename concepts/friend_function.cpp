@@ -70,7 +70,7 @@ void friendDemo() {
     Friend function accesses them directly
     */
 
-    BuyOrder b("AAPL", 2, 150);
+    BuyOrder b("AAPL", 2, Price::fromDouble(150));
 
     cout << "\nOrder Details:\n";
     cout << b;   // friend function prints order
@@ -22,13 +22,13 @@ using namespace std;
 
 // int version
 void addBalance(User& u, int amount) {
-    u.addBalance(amount); // add int amount
+    u.addBalance(Money::fromDouble(amount)); // add int amount
     cout << "Added int: " << amount << endl;
 }
 
 // double version
 void addBalance(User& u, double amount) {
-    u.addBalance(amount); // add double amount
+    u.addBalance(Money::fromDouble(amount)); // add double amount
     cout << "Added double: " << amount << endl;
 }
 
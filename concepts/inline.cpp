@@ -55,7 +55,7 @@ void tradingDemo() {
 
     int qty = 3;
 
-    double total = calculateTotal(s.price, qty); // inline used
+    double total = calculateTotal(s.price.toDouble(), qty); // inline used
 
     cout << "\nBuying Cost: " << total << endl;
 
@@ -25,8 +25,8 @@ using namespace std;
 
 void binaryDemo() {
 
-    BuyOrder o1("AAPL", 5, 150);
-    BuyOrder o2("AAPL", 5, 200);
+    BuyOrder o1("AAPL", 5, Price::fromDouble(150));
+    BuyOrder o2("AAPL", 5, Price::fromDouble(200));
 
     if (o1 < o2) { // operator< used
         cout << "o1 has lower price\n";
@@ -47,7 +47,7 @@ void unaryDemo() {
 
     cout << "\nBalance: " << u.getBalance() << endl;
 
-    u += 2000; // operator+= used
+    u += Money::fromDouble(2000); // operator+= used
 
     cout << "After += : " << u.getBalance() << endl;
 }
@@ -56,7 +56,7 @@ void unaryDemo() {
 
 void friendDemo() {
 
-    BuyOrder order("AAPL", 3, 150);
+    BuyOrder order("AAPL", 3, Price::fromDouble(150));
 
     cout << "\nOrder:\n";
 
@@ -67,8 +67,8 @@ void friendDemo() {
 
 void tradingDemo() {
 
-    BuyOrder o1("AAPL", 5, 150);
-    BuyOrder o2("AAPL", 5, 120);
+    BuyOrder o1("AAPL", 5, Price::fromDouble(150));
+    BuyOrder o2("AAPL", 5, Price::fromDouble(120));
 
     if (o1 < o2) {
         cout << "o1 cheaper\n";
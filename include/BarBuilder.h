@@ -0,0 +1,121 @@
+#ifndef BARBUILDER_H
+#define BARBUILDER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "SymbolTable.h"
+#include "Money.h"
+using namespace std;
+
+// Open/high/low/close/volume of one symbol over one interval
+struct Bar {
+    int64_t start = 0;       // ns since the epoch, a multiple of the interval
+    Price open, high, low, close;
+    int64_t volume = 0;
+    Money notional;          // sum of quantity * price
+    uint32_t trades = 0;
+
+    bool empty() const { return trades == 0; }
+    // Volume-weighted average price, zero for an empty bar
+    Price vwap() const { return volume ? Price::fromUnits(notional.raw() / volume) : Price(); }
+};
+
+// Streaming OHLCV bars for every symbol at 1s, 1m, 1h and 1d.
+//
+// Each symbol/interval pair has its open bar plus a fixed ring of the last
+// `keep` completed bars, all allocated up front, so a trade costs one update
+// per interval and never allocates. A bar completes when a trade (or
+// closeExpired) lands in a later interval; intervals with no trades make no
+// bar. Days are UTC days.
+//
+// Completed bars are appended to data/bars.txt by save(), one
+// INTERVAL|SYMBOL|start|open|high|low|close|volume|notional|trades line each
+// (start in seconds since the epoch), and load() puts them back in the rings
+// on the next run. Open bars are saved too when the application exits; a
+// trade that lands in the interval of the newest loaded bar reopens it, and
+// when the file has two lines for one bar the later one wins.
+//
+// A ring that is about to overwrite a bar not yet saved first appends that
+// series' unsaved bars to the spillTo() file, so a burst of short bars
+// between two saves is not lost. Without a spill file, or if it cannot be
+// opened, the overwritten bar is counted in droppedCount().
+class BarBuilder {
+public:
+    struct Interval {
+        const char* name;
+        int64_t nanos;
+        uint32_t keep;       // completed bars held in memory
+    };
+    static const size_t INTERVAL_COUNT = 4;
+    static const Interval INTERVALS[INTERVAL_COUNT];
+
+private:
+    struct Series {
+        Bar open;
+        uint32_t next = 0;       // ring slot the next completed bar goes in
+        uint32_t count = 0;      // completed bars in the ring
+        uint32_t unsaved = 0;    // newest completed bars not yet saved
+    };
+
+    size_t symbolCount;
+    vector<Series> series;      // [symbol * INTERVAL_COUNT + interval]
+    vector<Bar> history;        // every series' ring, back to back per symbol
+    size_t pending;             // completed bars not yet saved, all series
+    string spillPath;           // where a full ring's unsaved bars go, or empty
+    size_t dropped;             // unsaved bars overwritten without a spill
+
+    static size_t barsPerSymbol();
+    static size_t ringOffset(size_t interval);
+
+    Series& seriesFor(SymbolId symbol, size_t interval) { return series[symbol * INTERVAL_COUNT + interval]; }
+    const Series& seriesFor(SymbolId symbol, size_t interval) const { return series[symbol * INTERVAL_COUNT + interval]; }
+    Bar* ring(SymbolId symbol, size_t interval) { return &history[symbol * barsPerSymbol() + ringOffset(interval)]; }
+    const Bar* ring(SymbolId symbol, size_t interval) const { return &history[symbol * barsPerSymbol() + ringOffset(interval)]; }
+
+    void complete(SymbolId symbol, size_t interval, const Bar& bar, bool saved);
+    // Takes the newest completed bar back out of the ring if it starts at start
+    bool reopen(SymbolId symbol, size_t interval, int64_t start, Bar& into);
+    // Appends one series' unsaved bars to path, oldest first. Returns false,
+    // writing nothing, if the file cannot be opened.
+    bool spill(SymbolId symbol, size_t interval, const string& path);
+
+public:
+    explicit BarBuilder(size_t symbols = 0);
+
+    // Allocates the bars of symbols [0, count). onTrade grows the table on
+    // its own for a symbol it has not seen, but that first trade allocates.
+    void reserveSymbols(size_t count);
+
+    void onTrade(int64_t timestampNs, SymbolId symbol, int quantity, Price price);
+
+    // Completes every open bar whose interval ended before nowNs
+    void closeExpired(int64_t nowNs);
+
+    // The open bar (empty if nothing has traded in it)
+    const Bar& current(SymbolId symbol, size_t interval) const;
+    size_t completedCount(SymbolId symbol, size_t interval) const;
+    // age 0 is the most recent completed bar; throws out_of_range past completedCount
+    const Bar& completed(SymbolId symbol, size_t interval, size_t age) const;
+
+    size_t unsavedCount() const { return pending; }
+    size_t droppedCount() const { return dropped; }
+
+    // File complete() appends to before a ring overwrites an unsaved bar,
+    // normally the one save() appends to
+    void spillTo(const string& path) { spillPath = path; }
+
+    // Appends the completed bars not yet saved (and with withOpen, the open
+    // ones) to path and returns how many. Throws ios_base::failure if the
+    // file cannot be opened.
+    size_t save(const string& path, bool withOpen = false);
+    // Reads bars saved by earlier runs into the rings. Returns the bars read,
+    // or 0 if the file does not exist; skipped counts the malformed lines.
+    size_t load(const string& path, size_t& skipped);
+
+    // Index into INTERVALS for a name such as "1m", or -1
+    static int intervalIndex(string_view name);
+};
+
+#endif
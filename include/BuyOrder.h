@@ -4,15 +4,18 @@
 #include "Order.h"
 using namespace std;
 
-class BuyOrder : public Order {
+// final: calls through a BuyOrder (rather than an Order&) are direct, not virtual
+class BuyOrder final : public Order {
 private:
     int buyOrderCount;
 
 public:
-    BuyOrder(string sym, int q, double p);
+    BuyOrder(SymbolId sym, int q, Price p, OrderType t = OrderType::Limit, TimeInForce tif = TimeInForce::GTC);
+    BuyOrder(const string& sym, int q, Price p);
     ~BuyOrder();
 
     bool execute(User& user, Stock& stock) override;
+    bool execute(User& user, Stock& stock, OrderBook& book) override;
     void displayDetails() const override;
 };
 
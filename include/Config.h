@@ -0,0 +1,27 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+// Startup settings read from a key=value file (data/config.txt).
+// Blank lines and lines starting with # are ignored; a missing file or key
+// falls back to the default passed by the caller.
+class Config {
+private:
+    unordered_map<string, string> values;
+
+public:
+    // Returns false if the file does not exist. Throws invalid_argument for
+    // a line without '='.
+    bool load(const string& path);
+
+    bool has(const string& key) const { return values.count(key) != 0; }
+    string getString(const string& key, const string& fallback) const;
+    // Throws invalid_argument if the value is not a whole number
+    long long getInt(const string& key, long long fallback) const;
+};
+
+#endif
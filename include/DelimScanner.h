@@ -0,0 +1,135 @@
+#ifndef DELIMSCANNER_H
+#define DELIMSCANNER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+using namespace std;
+
+// One line of a delimiter-based record file together with the offsets of
+// its '|', ':' and ',' bytes (relative to the start of the line), taken
+// from the structural index so fields can be sliced without rescanning.
+struct DelimRecord {
+    const char* base;
+    size_t length;
+    const uint32_t* delims;
+    size_t count;
+
+    string_view line() const { return string_view(base, length); }
+    char delimAt(size_t i) const { return base[delims[i]]; }
+
+    // Text between delimiter i-1 and delimiter i (field 0 starts the line,
+    // field `count` runs to the end of the line)
+    string_view field(size_t i) const {
+        size_t start = i == 0 ? 0 : delims[i - 1] + 1;
+        size_t end = i < count ? delims[i] : length;
+        return string_view(base + start, end - start);
+    }
+};
+
+// Vectorised structural scanner for the pipe/colon/comma record formats.
+// scan() finds every '|', ':', ',' and '\n' in a buffer 32 bytes at a time
+// with AVX2 (chosen at run time when the CPU has it), 16 at a time with
+// SSE2, or byte by byte elsewhere.
+class DelimScanner {
+public:
+    // Writes the offsets of all delimiter bytes in [data, data + length) to
+    // out, which must have room for `length` entries. Returns how many.
+    static size_t scan(const char* data, size_t length, uint32_t* out);
+
+    // Number of '\n' bytes in text
+    static size_t countLines(string_view text);
+
+    // "avx2", "sse2" or "scalar"
+    static const char* implementation();
+
+    // Calls visit(const DelimRecord&) for every non-empty line. Works in
+    // blocks so the index stays in cache and offsets fit in 32 bits.
+    template <class Visit>
+    static size_t forEachRecord(string_view text, Visit&& visit);
+};
+
+// Digits-only integer parsing for fields already sliced by the scanner.
+// Returns false on empty input, stray characters or overflow.
+inline bool parseInt(string_view text, int& out) {
+    size_t i = 0;
+    bool negative = false;
+    if (!text.empty() && text[0] == '-') {
+        negative = true;
+        i = 1;
+    }
+    if (i == text.size() || text.size() - i > 10) return false;
+    int64_t value = 0;
+    for (; i < text.size(); i++) {
+        unsigned digit = (unsigned char)text[i] - '0';
+        if (digit > 9) return false;
+        value = value * 10 + digit;
+    }
+    if (negative) value = -value;
+    if (value > INT32_MAX || value < INT32_MIN) return false;
+    out = (int)value;
+    return true;
+}
+
+template <class Visit>
+size_t DelimScanner::forEachRecord(string_view text, Visit&& visit) {
+    const size_t BLOCK = 64 * 1024;
+    vector<uint32_t> index;
+    size_t records = 0;
+    size_t pos = 0;
+    size_t block = BLOCK;
+
+    while (pos < text.size()) {
+        size_t length = text.size() - pos < block ? text.size() - pos : block;
+        bool last = pos + length == text.size();
+        if (index.size() < length) index.resize(length);
+
+        const char* base = text.data() + pos;
+        size_t found = scan(base, length, index.data());
+
+        // Walk the index line by line; delimiters of the current line are
+        // the entries between lineFirst and the next '\n'
+        size_t lineStart = 0;
+        size_t lineFirst = 0;
+        for (size_t i = 0; i < found; i++) {
+            uint32_t offset = index[i];
+            if (base[offset] != '\n') continue;
+
+            size_t end = offset > lineStart && base[offset - 1] == '\r' ? offset - 1 : offset;
+            if (end > lineStart) {
+                // Rebase this line's delimiter offsets in place
+                for (size_t k = lineFirst; k < i; k++) index[k] -= (uint32_t)lineStart;
+                DelimRecord record = { base + lineStart, end - lineStart, index.data() + lineFirst, i - lineFirst };
+                visit(record);
+                records++;
+            }
+            lineStart = offset + 1;
+            lineFirst = i + 1;
+        }
+
+        if (last) {
+            // Final line without a trailing newline
+            size_t end = length > lineStart && base[length - 1] == '\r' ? length - 1 : length;
+            if (end > lineStart) {
+                for (size_t k = lineFirst; k < found; k++) index[k] -= (uint32_t)lineStart;
+                DelimRecord record = { base + lineStart, end - lineStart, index.data() + lineFirst, found - lineFirst };
+                visit(record);
+                records++;
+            }
+            break;
+        }
+
+        if (lineStart == 0) {
+            // A single line longer than the block: retry with a bigger one
+            block *= 2;
+            continue;
+        }
+        pos += lineStart;
+        block = BLOCK;
+    }
+    return records;
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <algorithm>
+#include "Money.h"
+using namespace std;
+
+enum class LogLevel : uint8_t { Debug, Info, Warn, Error, Off };
+
+// Messages below this level are compiled out: 0 Debug, 1 Info, 2 Warn, 3 Error
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 0
+#endif
+
+// A logging call site. Its address is the record's format id, so logging
+// copies a pointer instead of the format text.
+struct LogSite {
+    LogLevel level;
+    const char* format;   // each "{}" is replaced by the next argument
+};
+
+// Asynchronous message log. Until start() is called, messages are formatted
+// and written immediately, so short-lived programs need no setup. After
+// start(), each thread encodes its messages as compact binary records (site
+// pointer plus raw arguments) into its own single-producer ring and a
+// background thread formats and writes them. Strings are copied into the
+// record; numbers and Money are stored as raw integers and formatted later.
+// A producer never waits for the writer: if its ring is full the message is
+// dropped, and the writer notes the count in the output.
+class Log {
+public:
+    enum ArgType : uint8_t { INT, UINT, DOUBLE, MONEY, TEXT };
+
+    static constexpr size_t MAX_RECORD = 512;
+    static constexpr size_t MAX_TEXT = 255;   // longer strings are truncated
+
+    // Record layout: RecordHeader, then per argument an ArgType byte and its
+    // payload (8 bytes, or a length byte and the text)
+    struct RecordHeader {
+        uint32_t size;   // whole record including padding to 8 bytes
+        uint32_t argCount;
+        const LogSite* site;
+    };
+
+private:
+    struct Encoder {
+        char* pos;
+        char* end;
+        uint32_t count;
+    };
+
+    static atomic<uint8_t> minimumLevel;
+
+    static void putWord(Encoder& e, ArgType type, const void* word) {
+        if (e.pos + 9 > e.end) return;
+        *e.pos++ = (char)type;
+        memcpy(e.pos, word, 8);
+        e.pos += 8;
+        e.count++;
+    }
+
+    static void encode(Encoder& e, string_view text) {
+        if (e.pos + 2 > e.end) return;
+        size_t length = min(min(text.size(), MAX_TEXT), (size_t)(e.end - e.pos - 2));
+        *e.pos++ = (char)TEXT;
+        *e.pos++ = (char)(uint8_t)length;
+        memcpy(e.pos, text.data(), length);
+        e.pos += length;
+        e.count++;
+    }
+    static void encode(Encoder& e, const char* text) { encode(e, string_view(text)); }
+    static void encode(Encoder& e, const string& text) { encode(e, string_view(text)); }
+    static void encode(Encoder& e, Money value) {
+        int64_t units = value.raw();
+        putWord(e, MONEY, &units);
+    }
+    static void encode(Encoder& e, double value) { putWord(e, DOUBLE, &value); }
+    template <class T, typename enable_if<is_integral<T>::value, int>::type = 0>
+    static void encode(Encoder& e, T value) {
+        if (is_signed<T>::value) {
+            int64_t v = (int64_t)value;
+            putWord(e, INT, &v);
+        } else {
+            uint64_t v = (uint64_t)value;
+            putWord(e, UINT, &v);
+        }
+    }
+
+    static void submit(const char* record, size_t size);
+
+public:
+    template <class... Args>
+    static void write(const LogSite& site, const Args&... args) {
+        if ((uint8_t)site.level < minimumLevel.load(memory_order_relaxed)) return;
+
+        alignas(8) char record[MAX_RECORD];
+        Encoder e = { record + sizeof(RecordHeader), record + sizeof(record), 0 };
+        (encode(e, args), ...);
+
+        RecordHeader header;
+        header.size = (uint32_t)((e.pos - record + 7) & ~(size_t)7);
+        header.argCount = e.count;
+        header.site = &site;
+        memcpy(record, &header, sizeof(header));
+        submit(record, header.size);
+    }
+
+    // Appends the text of one record to out
+    static void format(const char* record, string& out);
+
+    // Starts the background writer. Messages then go to out asynchronously.
+    static void start(ostream& out = cout);
+    // Returns once everything logged before the call has been written
+    static void flush();
+    // Drains the rings and stops the writer; later messages are written immediately
+    static void stop();
+    static bool isRunning();
+    // Messages dropped because their thread's ring was full
+    static uint64_t dropped();
+
+    static void setLevel(LogLevel level) { minimumLevel.store((uint8_t)level, memory_order_relaxed); }
+    static LogLevel getLevel() { return (LogLevel)minimumLevel.load(memory_order_relaxed); }
+};
+
+// True if messages at level are compiled in. Compared as LogLevel: as ints,
+// an unsigned level against LOG_LEVEL 0 warns as always true (-Wtype-limits).
+constexpr bool logCompiledIn(LogLevel level) {
+    return level >= (LogLevel)LOG_LEVEL;
+}
+
+#define LOG_AT(lvl, fmt, ...)                                         \
+    do {                                                               \
+        if constexpr (logCompiledIn(lvl)) {                            \
+            static const LogSite logSite_ = { lvl, fmt };              \
+            Log::write(logSite_, ##__VA_ARGS__);                       \
+        }                                                              \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...) LOG_AT(LogLevel::Debug, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...) LOG_AT(LogLevel::Info, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...) LOG_AT(LogLevel::Warn, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LogLevel::Error, fmt, ##__VA_ARGS__)
+
+#endif
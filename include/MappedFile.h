@@ -0,0 +1,57 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+using namespace std;
+
+// Read-only memory mapping of a whole file. Records are parsed straight
+// out of the mapping as string_view slices, with no read buffer or copies.
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+    // Throws ios_base::failure if the file cannot be opened or mapped
+    explicit MappedFile(const string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file does not exist or cannot be mapped
+    bool open(const string& path);
+    void close();
+
+    bool isOpen() const;
+    string_view contents() const { return string_view(data, length); }
+    size_t size() const { return length; }
+};
+
+// Calls visit(string_view line) for every non-empty line, without the
+// line terminator (\n or \r\n)
+template <class Visit>
+void forEachLine(string_view text, Visit&& visit) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* lineEnd = nl ? nl : end;
+        const char* trimmed = lineEnd > p && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+        if (trimmed > p) {
+            visit(string_view(p, trimmed - p));
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+using namespace std;
+
+// Fixed-point decimal stored as an integer count of 1/Scale units.
+// All comparisons and arithmetic are integer operations; doubles only
+// appear when converting user input or printing.
+template <int64_t Scale>
+class Fixed {
+private:
+    int64_t units;
+
+    constexpr explicit Fixed(int64_t u) : units(u) {}
+
+public:
+    static const int64_t SCALE = Scale;
+
+    constexpr Fixed() : units(0) {}
+
+    static constexpr Fixed fromUnits(int64_t u) { return Fixed(u); }
+    static constexpr Fixed max() { return Fixed(INT64_MAX); }
+    static constexpr Fixed min() { return Fixed(INT64_MIN); }
+
+    // Rounds to the nearest unit; throws if the value cannot be represented
+    static Fixed fromDouble(double value) {
+        double scaled = value * Scale;
+        if (!isfinite(scaled) || fabs(scaled) >= 9.2e18) {
+            throw overflow_error("Amount out of range");
+        }
+        return Fixed((int64_t)llround(scaled));
+    }
+
+    // Parses plain decimal text such as "150", "150.5" or "-0.25".
+    // Digits beyond the scale are rejected rather than rounded.
+    static bool tryParse(string_view text, Fixed& out) {
+        size_t i = 0;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+            negative = text[i] == '-';
+            i++;
+        }
+        int64_t whole = 0;
+        size_t digits = 0;
+        for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+            if (whole > (INT64_MAX / Scale - 9) / 10) return false;
+            whole = whole * 10 + (text[i] - '0');
+        }
+        int64_t frac = 0;
+        int64_t place = Scale;
+        if (i < text.size() && text[i] == '.') {
+            for (i++; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++, digits++) {
+                if (place > 1) {
+                    place /= 10;
+                    frac += (text[i] - '0') * place;
+                } else if (text[i] != '0') {
+                    return false;
+                }
+            }
+        }
+        if (digits == 0 || i != text.size()) return false;
+        int64_t total = whole * Scale + frac;
+        out = Fixed(negative ? -total : total);
+        return true;
+    }
+
+    static Fixed parse(string_view text) {
+        Fixed value;
+        if (!tryParse(text, value)) {
+            throw invalid_argument("Invalid decimal: " + string(text));
+        }
+        return value;
+    }
+
+    constexpr int64_t raw() const { return units; }
+    constexpr double toDouble() const { return (double)units / Scale; }
+
+    // Shortest decimal form: 150, 150.5, 150.05
+    string toString() const {
+        char text[FORMAT_SIZE];
+        return string(text, format(text));
+    }
+
+    static const size_t FORMAT_SIZE = 48;
+
+    // Writes toString()'s text into out (FORMAT_SIZE bytes) without allocating
+    // and returns its length
+    size_t format(char* out) const {
+        uint64_t absolute = units < 0 ? 0 - (uint64_t)units : (uint64_t)units;
+        char digits[24];
+        size_t count = 0;
+        uint64_t whole = absolute / Scale;
+        do {
+            digits[count++] = (char)('0' + whole % 10);
+            whole /= 10;
+        } while (whole);
+
+        size_t length = 0;
+        if (units < 0) out[length++] = '-';
+        while (count) out[length++] = digits[--count];
+
+        uint64_t frac = absolute % Scale;
+        if (frac != 0) {
+            out[length++] = '.';
+            for (uint64_t place = Scale / 10; place > 0 && frac != 0; place /= 10) {
+                out[length++] = (char)('0' + frac / place);
+                frac %= place;
+            }
+        }
+        return length;
+    }
+
+    constexpr Fixed operator+(Fixed other) const { return Fixed(units + other.units); }
+    constexpr Fixed operator-(Fixed other) const { return Fixed(units - other.units); }
+    constexpr Fixed operator-() const { return Fixed(-units); }
+    constexpr Fixed operator*(int64_t quantity) const { return Fixed(units * quantity); }
+
+    // units * numerator / denominator, truncated toward zero like the
+    // integer division it replaces. Splitting off the remainder keeps every
+    // intermediate within 64 bits, so only a result that does not fit can
+    // overflow. The denominator must be positive.
+    constexpr Fixed mulDiv(int32_t numerator, int32_t denominator) const {
+        return Fixed(units / denominator * numerator + units % denominator * numerator / denominator);
+    }
+    Fixed& operator+=(Fixed other) { units += other.units; return *this; }
+    Fixed& operator-=(Fixed other) { units -= other.units; return *this; }
+
+    constexpr bool operator==(Fixed other) const { return units == other.units; }
+    constexpr bool operator!=(Fixed other) const { return units != other.units; }
+    constexpr bool operator<(Fixed other) const { return units < other.units; }
+    constexpr bool operator<=(Fixed other) const { return units <= other.units; }
+    constexpr bool operator>(Fixed other) const { return units > other.units; }
+    constexpr bool operator>=(Fixed other) const { return units >= other.units; }
+
+    friend ostream& operator<<(ostream& os, Fixed value) {
+        return os << value.toString();
+    }
+};
+
+template <int64_t Scale>
+constexpr Fixed<Scale> operator*(int64_t quantity, Fixed<Scale> value) {
+    return value * quantity;
+}
+
+// Cash amounts and prices share one scale (cents), so price * quantity is
+// directly a cash amount and one price tick is one unit.
+typedef Fixed<100> Money;
+typedef Money Price;
+
+#endif
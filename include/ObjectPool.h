@@ -0,0 +1,121 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <stdexcept>
+#include <cstdint>
+using namespace std;
+
+// Stable reference to a pooled object. A slot's generation changes every time
+// it is reused, so a handle to a destroyed object never reaches its successor.
+struct PoolHandle {
+    static constexpr uint32_t NO_INDEX = 0xFFFFFFFFu;
+
+    uint32_t index;
+    uint32_t generation;
+
+    static constexpr PoolHandle none() { return { NO_INDEX, 0 }; }
+    constexpr bool isNone() const { return index == NO_INDEX; }
+    constexpr bool operator==(PoolHandle other) const { return index == other.index && generation == other.generation; }
+    constexpr bool operator!=(PoolHandle other) const { return !(*this == other); }
+};
+
+// Fixed-capacity pool of T. Every slot is allocated up front, objects never
+// move, and free slots are chained through their own storage, so create()
+// and destroy() are a few stores and never touch the global heap.
+template <class T>
+class ObjectPool {
+private:
+    struct Slot {
+        union {
+            alignas(T) unsigned char object[sizeof(T)];
+            uint32_t nextFree;   // while the slot is free
+        };
+        uint32_t generation;     // odd while an object is live
+    };
+
+    unique_ptr<Slot[]> slots;
+    uint32_t slotCount;
+    uint32_t freeHead;
+    uint32_t liveCount;
+    uint32_t peakCount;
+
+    T* objectAt(uint32_t index) const {
+        return reinterpret_cast<T*>(slots[index].object);
+    }
+
+public:
+    explicit ObjectPool(size_t capacity) {
+        if (capacity == 0 || capacity >= PoolHandle::NO_INDEX) {
+            throw invalid_argument("Object pool capacity out of range");
+        }
+        slotCount = (uint32_t)capacity;
+        slots.reset(new Slot[slotCount]);
+        for (uint32_t i = 0; i < slotCount; i++) {
+            slots[i].nextFree = i + 1 < slotCount ? i + 1 : PoolHandle::NO_INDEX;
+            slots[i].generation = 0;
+        }
+        freeHead = 0;
+        liveCount = 0;
+        peakCount = 0;
+    }
+
+    ~ObjectPool() {
+        for (uint32_t i = 0; i < slotCount; i++) {
+            if (slots[i].generation & 1) objectAt(i)->~T();
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Constructs a T in a free slot. Throws runtime_error when the pool is full.
+    template <class... Args>
+    PoolHandle create(Args&&... args) {
+        if (freeHead == PoolHandle::NO_INDEX) {
+            throw runtime_error("Object pool is full");
+        }
+        uint32_t index = freeHead;
+        Slot& slot = slots[index];
+        uint32_t next = slot.nextFree;
+        new (slot.object) T(std::forward<Args>(args)...);
+        freeHead = next;
+        slot.generation++;
+        liveCount++;
+        if (liveCount > peakCount) peakCount = liveCount;
+        return { index, slot.generation };
+    }
+
+    // Returns false if the handle is stale or was never issued
+    bool destroy(PoolHandle handle) {
+        if (!get(handle)) return false;
+        Slot& slot = slots[handle.index];
+        objectAt(handle.index)->~T();
+        slot.generation++;
+        slot.nextFree = freeHead;
+        freeHead = handle.index;
+        liveCount--;
+        return true;
+    }
+
+    // Null if the handle is stale
+    T* get(PoolHandle handle) const {
+        if (handle.index >= slotCount) return nullptr;
+        const Slot& slot = slots[handle.index];
+        return slot.generation == handle.generation && (slot.generation & 1) ? objectAt(handle.index) : nullptr;
+    }
+
+    // Unchecked access by slot index, for structures that link live objects
+    // to each other by index
+    T& at(uint32_t index) const { return *objectAt(index); }
+    PoolHandle handleAt(uint32_t index) const { return { index, slots[index].generation }; }
+
+    bool full() const { return freeHead == PoolHandle::NO_INDEX; }
+    size_t size() const { return liveCount; }
+    size_t capacity() const { return slotCount; }
+    size_t peak() const { return peakCount; }
+};
+
+#endif
@@ -5,31 +5,103 @@
 #include <string>
 #include "User.h"
 #include "Stock.h"
+#include "OrderBook.h"
+#include "RiskEngine.h"
+#include "Money.h"
 using namespace std;
 
+// A limit order trades at its price or better; a market order takes
+// whatever the book and the stock's inventory offer
+enum class OrderType : uint8_t { Limit, Market };
+
+// What happens to the part of an order that does not trade at once: it
+// rests on the book (GTC), is cancelled (IOC), or, for fill-or-kill, the
+// whole order is cancelled unless all of it can trade (FOK)
+enum class TimeInForce : uint8_t { GTC, IOC, FOK };
+
+// Told about every trade an order takes part in, once per side: the order
+// that came in and, for a fill against the book, the resting order it hit
+// (maker set). orderId is the order's id, 0 for a resting order placed
+// without one.
+class TradeListener {
+public:
+    virtual ~TradeListener() {}
+    virtual void onTrade(User& user, Side side, SymbolId symbol, int quantity, Price price,
+                         uint64_t orderId, bool maker) = 0;
+};
+
 class Order {
 protected:
-    string symbol;
+    uint64_t id;              // from one sequence shared by every order
+    SymbolId symbol;
     int quantity;
-    double price;
+    Price price;
+    int filled;               // quantity executed so far
+    Money filledValue;        // sum of fill quantity * fill price
+    PoolHandle restingHandle; // book handle of the unfilled remainder, if any
+    RiskReject rejected;      // why the last execute() was refused, if it was
+    OrderType type;
+    TimeInForce timeInForce;  // never GTC for a market order
+    bool killed;              // a fill-or-kill order that could not fill
+    static uint64_t lastId;
+    static TradeListener* tradeListener;
+
+    void notifyTrade(User& user, Side side, int tradeQuantity, Price tradePrice, uint64_t orderId, bool maker = false) const {
+        if (tradeListener) tradeListener->onTrade(user, side, symbol, tradeQuantity, tradePrice, orderId, maker);
+    }
+
+    // The price the order may trade to: its limit, or for a market order the
+    // worst price a sweep of quantity would reach, book levels first and
+    // then the stock's inventory
+    Price tradeLimit(Side side, const Stock& stock, const OrderBook& book) const;
+    // Whether all of quantity would trade at limit now. Reads the book's
+    // level totals and the stock, changes nothing.
+    bool fillable(Side side, const Stock& stock, const OrderBook& book, Price limit) const;
+    // How much of remaining the stock's inventory takes at limit: any amount
+    // of a sale, and of a purchase what it holds. A GTC purchase takes it only
+    // if it holds all of remaining; otherwise the remainder rests whole.
+    int fromInventory(Side side, const Stock& stock, Price limit, int remaining) const;
+    // "Limit GTC", "Market IOC"...
+    string describeTerms() const;
 
 public:
-    Order(string sym, int q, double p);
+    // The price of a market order is not used
+    Order(SymbolId sym, int q, Price p, OrderType t = OrderType::Limit, TimeInForce tif = TimeInForce::GTC);
+    Order(const string& sym, int q, Price p);
     virtual ~Order();
 
     virtual bool execute(User& user, Stock& stock) = 0;
+    // Submit into the symbol's book: match resting orders, then the stock's
+    // own inventory, and leave any remainder resting at the limit price
+    virtual bool execute(User& user, Stock& stock, OrderBook& book) = 0;
     virtual void displayDetails() const;
 
-    // Simple operators: compare by price then symbol, equality by all fields
+    // Simple operators: compare by price then symbol, equality by order id
     bool operator<(Order const& other) const noexcept;
     bool operator==(Order const& other) const noexcept;
 
     // Printing helper
     friend ostream& operator<<(ostream& os, const Order& o);
 
-    string getSymbol() const { return symbol; }
+    // Ids start at 1 and are never reused in a run
+    static uint64_t nextId() { return ++lastId; }
+    // Null for none. Returns the listener it replaces.
+    static TradeListener* setTradeListener(TradeListener* l) { TradeListener* old = tradeListener; tradeListener = l; return old; }
+
+    uint64_t getId() const { return id; }
+    SymbolId getSymbol() const { return symbol; }
     int getQuantity() const { return quantity; }
-    double getPrice() const { return price; }
+    Price getPrice() const { return price; }
+    int getFilledQuantity() const { return filled; }
+    Money getFilledValue() const { return filledValue; }
+    // Average fill price, rounded down to a whole tick
+    Price getAveragePrice() const { return filled > 0 ? Price::fromUnits(filledValue.raw() / filled) : Price(); }
+    bool isResting() const { return !restingHandle.isNone(); }
+    bool wasKilled() const { return killed; }
+    OrderType getType() const { return type; }
+    TimeInForce getTimeInForce() const { return timeInForce; }
+    RiskReject getRejectReason() const { return rejected; }
+    PoolHandle getRestingHandle() const { return restingHandle; }
 };
 
 #endif
@@ -0,0 +1,65 @@
+#ifndef ORDERBATCH_H
+#define ORDERBATCH_H
+
+#include <vector>
+#include <variant>
+#include <utility>
+#include "BuyOrder.h"
+#include "SellOrder.h"
+using namespace std;
+
+// An order held by value. std::visit picks the alternative with a switch on
+// the index, and since both classes are final the execute() it reaches is a
+// direct call.
+typedef variant<BuyOrder, SellOrder> OrderVariant;
+
+// One order of a batch and the account it trades for
+struct BatchEntry {
+    OrderVariant order;
+    User* user;
+    bool executed;
+
+    template <class T, class... Args>
+    BatchEntry(User* owner, in_place_type_t<T> type, Args&&... args)
+        : order(type, std::forward<Args>(args)...), user(owner), executed(false) {}
+};
+
+// A run of orders stored contiguously and executed in submission order
+// through the book path, without virtual dispatch or a pointer per order.
+// The polymorphic Order interface is unchanged; each entry can still be
+// viewed as an Order& through asOrder().
+class OrderBatch {
+private:
+    vector<BatchEntry> entries;
+
+public:
+    // Reserving up front matters: growing copies (and destroys) every order
+    void reserve(size_t count) { entries.reserve(count); }
+    void clear() { entries.clear(); }
+
+    void addBuy(User* user, SymbolId symbol, int quantity, Price price) {
+        entries.emplace_back(user, in_place_type<BuyOrder>, symbol, quantity, price);
+    }
+    void addSell(User* user, SymbolId symbol, int quantity, Price price) {
+        entries.emplace_back(user, in_place_type<SellOrder>, symbol, quantity, price);
+    }
+
+    // Runs every entry against stocksBySymbol[symbol] and books[symbol].
+    // Entries whose symbol has no stock or book are skipped. Returns the
+    // number of orders that executed.
+    size_t execute(const vector<Stock*>& stocksBySymbol, const vector<OrderBook*>& books);
+
+    size_t size() const { return entries.size(); }
+    BatchEntry& operator[](size_t i) { return entries[i]; }
+    const BatchEntry& operator[](size_t i) const { return entries[i]; }
+
+    static Side sideOf(const OrderVariant& order) { return order.index() == 0 ? Side::Buy : Side::Sell; }
+    static Order& asOrder(OrderVariant& order) {
+        return visit([](auto& o) -> Order& { return o; }, order);
+    }
+    static const Order& asOrder(const OrderVariant& order) {
+        return visit([](const auto& o) -> const Order& { return o; }, order);
+    }
+};
+
+#endif
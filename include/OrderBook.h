@@ -0,0 +1,242 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "User.h"
+#include "SymbolTable.h"
+#include "Money.h"
+#include "ObjectPool.h"
+#include "OrderIndex.h"
+using namespace std;
+
+enum class Side : uint8_t { Buy, Sell };
+
+// One execution against a resting order
+struct Fill {
+    User* maker;          // owner of the resting order (counterparty)
+    PoolHandle makerHandle; // handle of the resting order that traded
+    int quantity;
+    Price price;          // resting order's price
+    bool makerDone;       // resting order fully filled and removed
+    uint64_t makerId;     // order id of the resting order, 0 if it had none
+};
+
+// Price-time priority limit order book for one symbol.
+// Resting orders live in a fixed ObjectPool sized when the book is built and
+// price levels in an index-linked pool with a free list, reserved at its full
+// size up front, as are both ladders and the free list, so adding, matching
+// and cancelling never allocate. Each side keeps a ladder of level indices
+// sorted so the best price is at the back: bids ascending, asks descending.
+// An order that would need a price level when all are in use is refused like
+// one arriving at a full order pool.
+//
+// A book given an OrderIndex enters every order that rests with an id and
+// takes it out when the order fills completely or is cancelled, so the
+// order can be cancelled or reduced by id.
+class OrderBook {
+public:
+    static const uint32_t NO_ORDER = 0xFFFFFFFFu;   // end of an order list
+    static const size_t DEFAULT_MAX_ORDERS = 4096;
+    static const size_t DEFAULT_MAX_LEVELS = 1024;
+
+    struct BookOrder {
+        User* owner;
+        Price price;
+        int quantity;
+        uint32_t level;
+        uint32_t prev;
+        uint32_t next;
+        Side side;
+        uint64_t id;      // order id, 0 if the order has none
+    };
+
+private:
+
+    struct PriceLevel {
+        Price price;
+        long long quantity;  // total resting quantity at this price
+        uint32_t head;       // oldest order (first to trade)
+        uint32_t tail;
+        uint32_t count;
+    };
+
+    SymbolId symbol;
+    ObjectPool<BookOrder> orders;   // linked by slot index within a level
+    size_t maxLevels;
+    vector<PriceLevel> levels;      // grows within its reserved maxLevels only
+    vector<uint32_t> freeLevels;
+    vector<uint32_t> bids;
+    vector<uint32_t> asks;
+    OrderIndex* index;              // null unless setIndex() was called
+
+    // NO_ORDER if every level is in use
+    uint32_t allocLevel(Price price);
+    uint32_t findOrInsertLevel(Side side, Price price);
+    void eraseLevel(Side side, uint32_t levelIndex);
+    void unlink(uint32_t index);
+    // Takes a resting order off the book, level quantity and empty level included
+    void remove(uint32_t index);
+
+    static bool crosses(Side incoming, Price limit, Price restingPrice) {
+        return incoming == Side::Buy ? restingPrice <= limit : restingPrice >= limit;
+    }
+
+public:
+    // maxLevels is capped at maxOrders: every level holds at least one order
+    explicit OrderBook(SymbolId sym, size_t maxOrders = DEFAULT_MAX_ORDERS,
+                       size_t maxLevels = DEFAULT_MAX_LEVELS);
+
+    // Trade an incoming order against the opposite side, best price first and
+    // oldest first within a level. onFill(const Fill&) is called per execution.
+    // Returns the quantity left unfilled.
+    template <class OnFill>
+    int match(Side side, int quantity, Price limit, OnFill&& onFill);
+
+    // Place quantity on the book without matching, under order id (0 for
+    // none). Returns its handle, or PoolHandle::none() if the book already
+    // holds maxOrders orders, or needs a new price level and has maxLevels.
+    PoolHandle rest(Side side, User* owner, int quantity, Price price, uint64_t id = 0);
+
+    // How much of quantity an incoming order on side could take from the
+    // opposite side at limit right now, and in worst the price of the last
+    // level it would reach. Reads only level totals, best level first, and
+    // stops once quantity is covered.
+    int crossable(Side side, int quantity, Price limit, Price* worst = nullptr) const;
+
+    // match() followed by rest() of whatever is left
+    template <class OnFill>
+    PoolHandle add(Side side, User* owner, int quantity, Price price, OnFill&& onFill);
+
+    // Cancel and reduce are O(1) unless they empty a price level: that level
+    // then leaves its ladder, which is a pop for the best level but a binary
+    // search and a shift of every better level for the others, O(levels).
+    bool cancel(PoolHandle handle);
+    // cancel() that first calls onCancel(owner, side, quantity, price) with
+    // what was still resting
+    template <class OnCancel>
+    bool cancel(PoolHandle handle, OnCancel&& onCancel);
+    // Lowers a resting order's quantity to quantity without losing its place
+    // in the queue, calling onReduce(owner, side, removed, price). Returns
+    // false for a dead handle or a quantity not below the resting one; zero
+    // cancels the order.
+    template <class OnReduce>
+    bool reduce(PoolHandle handle, int quantity, OnReduce&& onReduce);
+
+    // Orders resting with an id are entered in index from now on
+    void setIndex(OrderIndex* orderIndex) { index = orderIndex; }
+
+    // Removes every resting order, calling onCancel(owner, side, quantity, price)
+    // for each so whoever placed them can be made whole
+    template <class OnCancel>
+    void cancelAll(OnCancel&& onCancel);
+
+    // False once the order has been filled or cancelled, even if its slot
+    // has been reused since
+    bool isLive(PoolHandle handle) const { return orders.get(handle) != nullptr; }
+    int restingQuantity(PoolHandle handle) const;
+    // Null once the order has been filled or cancelled
+    const BookOrder* find(PoolHandle handle) const { return orders.get(handle); }
+
+    bool hasBid() const { return !bids.empty(); }
+    bool hasAsk() const { return !asks.empty(); }
+    Price bestBid() const { return levels[bids.back()].price; }
+    Price bestAsk() const { return levels[asks.back()].price; }
+    long long bidSize() const { return levels[bids.back()].quantity; }
+    long long askSize() const { return levels[asks.back()].quantity; }
+
+    size_t orderCount() const { return orders.size(); }
+    size_t orderCapacity() const { return orders.capacity(); }
+    size_t orderPeak() const { return orders.peak(); }
+    size_t levelCount(Side side) const { return side == Side::Buy ? bids.size() : asks.size(); }
+    size_t levelCapacity() const { return maxLevels; }
+    SymbolId getSymbol() const { return symbol; }
+
+    void display(int depth = 5) const;
+};
+
+template <class OnFill>
+int OrderBook::match(Side side, int quantity, Price limit, OnFill&& onFill) {
+    vector<uint32_t>& ladder = side == Side::Buy ? asks : bids;
+    Side restingSide = side == Side::Buy ? Side::Sell : Side::Buy;
+
+    while (quantity > 0 && !ladder.empty()) {
+        uint32_t levelIndex = ladder.back();
+        PriceLevel& level = levels[levelIndex];
+        if (!crosses(side, limit, level.price)) break;
+
+        while (quantity > 0 && level.head != NO_ORDER) {
+            uint32_t index = level.head;
+            BookOrder& resting = orders.at(index);
+            int traded = resting.quantity < quantity ? resting.quantity : quantity;
+
+            resting.quantity -= traded;
+            level.quantity -= traded;
+            quantity -= traded;
+
+            Fill fill = { resting.owner, orders.handleAt(index), traded, level.price, resting.quantity == 0, resting.id };
+            if (fill.makerDone) {
+                unlink(index);
+            }
+            onFill(fill);
+        }
+
+        if (level.head == NO_ORDER) {
+            eraseLevel(restingSide, levelIndex);
+        }
+    }
+    return quantity;
+}
+
+template <class OnFill>
+PoolHandle OrderBook::add(Side side, User* owner, int quantity, Price price, OnFill&& onFill) {
+    int remaining = match(side, quantity, price, onFill);
+    if (remaining == 0) return PoolHandle::none();
+    return rest(side, owner, remaining, price);
+}
+
+template <class OnCancel>
+bool OrderBook::cancel(PoolHandle handle, OnCancel&& onCancel) {
+    BookOrder* order = orders.get(handle);
+    if (!order) return false;
+    onCancel(order->owner, order->side, order->quantity, order->price);
+    remove(handle.index);
+    return true;
+}
+
+template <class OnReduce>
+bool OrderBook::reduce(PoolHandle handle, int quantity, OnReduce&& onReduce) {
+    BookOrder* order = orders.get(handle);
+    if (!order || quantity < 0 || quantity >= order->quantity) return false;
+    if (quantity == 0) return cancel(handle, onReduce);
+
+    int removed = order->quantity - quantity;
+    order->quantity = quantity;
+    levels[order->level].quantity -= removed;
+    onReduce(order->owner, order->side, removed, order->price);
+    return true;
+}
+
+template <class OnCancel>
+void OrderBook::cancelAll(OnCancel&& onCancel) {
+    for (Side side : { Side::Buy, Side::Sell }) {
+        vector<uint32_t>& ladder = side == Side::Buy ? bids : asks;
+        for (uint32_t levelIndex : ladder) {
+            uint32_t index = levels[levelIndex].head;
+            while (index != NO_ORDER) {
+                BookOrder& order = orders.at(index);
+                uint32_t next = order.next;
+                onCancel(order.owner, side, order.quantity, order.price);
+                if (this->index && order.id != 0) this->index->erase(order.id);
+                orders.destroy(orders.handleAt(index));
+                index = next;
+            }
+            freeLevels.push_back(levelIndex);
+        }
+        ladder.clear();
+    }
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ORDERINDEX_H
+#define ORDERINDEX_H
+
+#include <vector>
+#include <cstdint>
+#include "ObjectPool.h"
+using namespace std;
+
+class OrderBook;
+
+// Resting orders by order id, so cancels and amends go straight to the
+// order instead of searching a book's price levels.
+//
+// Ids come from one global sequence (Order::nextId). An order with an id is
+// entered when it rests on a book that uses this index, and the book takes
+// it out again when it fills completely or is cancelled, so only live orders
+// are here. Entries are {id, book, handle} slots of an open-addressing table
+// with linear probing and backward-shift removal, as in PositionMap: a
+// lookup hashes the id and usually compares one slot, and the handle then
+// leads to the order in its book's pool. The table is kept at most three
+// quarters full and never shrinks, so steady cancel traffic does not allocate.
+class OrderIndex {
+public:
+    struct Entry {
+        uint64_t id;         // 0 if the slot is free
+        OrderBook* book;
+        PoolHandle handle;
+    };
+
+private:
+    vector<Entry> slots;     // size is zero or a power of two
+    size_t count;
+    uint32_t shift;          // 64 - log2(slots.size())
+
+    // Fibonacci hashing: ids are consecutive, the multiply spreads them
+    size_t home(uint64_t id) const { return (size_t)((id * 0x9E3779B97F4A7C15ull) >> shift); }
+    size_t findSlot(uint64_t id) const;
+    void rehash(size_t size);
+
+public:
+    OrderIndex() : count(0), shift(64) {}
+
+    // Called by the book an order rests on
+    void insert(uint64_t id, OrderBook* book, PoolHandle handle);
+    bool erase(uint64_t id);
+
+    // Null if no order with that id is resting
+    const Entry* find(uint64_t id) const;
+
+    // Takes the order off its book and hands its reservation back. Returns
+    // false if no order with that id is resting.
+    bool cancel(uint64_t id);
+    // Lowers the order's open quantity to quantity, keeping its place in
+    // the queue, and hands back the reservation of the difference; zero
+    // cancels it. Returns false if the order is not resting or quantity is
+    // not below its open quantity (raising it needs a cancel/replace).
+    bool reduce(uint64_t id, int quantity);
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Calls fn(const Entry&) for every resting order, in no particular order
+    template <class Fn>
+    void forEach(Fn&& fn) const {
+        for (const Entry& e : slots) {
+            if (e.id != 0) fn(e);
+        }
+    }
+};
+
+#endif
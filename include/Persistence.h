@@ -0,0 +1,64 @@
+#ifndef PERSISTENCE_H
+#define PERSISTENCE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include "User.h"
+#include "UserDirectory.h"
+#include "Stock.h"
+using namespace std;
+
+// Saves of every user and stock.
+// The base is snapshot.bin (see Snapshot), or users.txt and stocks.txt while
+// there is no snapshot yet. Changed records are appended to users.log /
+// stocks.log in the users.txt / stocks.txt line format; on load the logs are
+// replayed over the base and the newest line for a name or symbol wins.
+// Once a log holds more lines than there are records it is compacted, which
+// rewrites the snapshot and empties the log, so the rewrite cost is spread
+// over at least as many saves as there are records. The text files are
+// only written on request, as an export.
+class Persistence {
+private:
+    string dataDir;
+    ofstream usersLog;
+    ofstream stocksLog;
+    size_t usersLogLines;
+    size_t stocksLogLines;
+
+    void openLogs();
+
+public:
+    static constexpr size_t MIN_COMPACT_LINES = 1024;
+
+    explicit Persistence(string dir = "data");
+
+    string usersPath() const { return dataDir + "/users.txt"; }
+    string stocksPath() const { return dataDir + "/stocks.txt"; }
+    string usersLogPath() const { return dataDir + "/users.log"; }
+    string stocksLogPath() const { return dataDir + "/stocks.log"; }
+    string snapshotPath() const { return dataDir + "/snapshot.bin"; }
+
+    // Loads the snapshot into the empty users and stocks. Returns false if
+    // there is none; throws runtime_error if it cannot be used.
+    bool loadSnapshot(UserDirectory& users, vector<Stock*>& stocks);
+
+    // Replay the change logs over freshly loaded base records
+    void replayUsers(UserDirectory& users);
+    void replayStocks(vector<Stock*>& stocks);
+
+    // Append every dirty user and stock to the logs. Returns records written.
+    size_t flush();
+
+    bool needsCompaction(size_t userCount, size_t stockCount) const;
+
+    // Rewrite the snapshot from memory and truncate the logs. The logs are
+    // only truncated once the new snapshot has been renamed into place.
+    void compact(const UserDirectory& users, const vector<Stock*>& stocks);
+
+    // Rewrite users.txt and stocks.txt from memory, each through a temporary
+    // file renamed into place; the logs are untouched
+    void exportText(const UserDirectory& users, const vector<Stock*>& stocks);
+};
+
+#endif
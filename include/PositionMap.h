@@ -0,0 +1,84 @@
+#ifndef POSITIONMAP_H
+#define POSITIONMAP_H
+
+#include <vector>
+#include <cstdint>
+#include "SymbolTable.h"
+using namespace std;
+
+struct Position {
+    SymbolId symbol;
+    int quantity;
+    int reserved;    // of quantity, held back for open sell orders
+};
+
+// A user's holdings keyed by symbol. Positions live in a dense array (what
+// iteration walks) and an open-addressing table of {symbol, index} slots
+// finds them with linear probing, so a lookup compares ids in one or two
+// adjacent slots and never touches a string. Removal swaps the last position
+// into the hole and shifts the probe run back instead of leaving tombstones.
+// Capacity is only ever grown, so steady-state buys and sells do not allocate.
+class PositionMap {
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFFu;
+
+    struct Slot {
+        SymbolId symbol;
+        uint32_t index;   // into positions, EMPTY if the slot is free
+    };
+
+    vector<Position> positions;
+    vector<Slot> slots;    // size is zero or a power of two
+    uint32_t shift;        // 32 - log2(slots.size())
+
+    // Fibonacci hashing: SymbolIds are dense small integers, the multiply
+    // spreads consecutive ids across the table
+    size_t home(SymbolId symbol) const {
+        return (size_t)((uint32_t)(symbol * 2654435769u) >> shift);
+    }
+
+    size_t findSlot(SymbolId symbol) const {
+        size_t mask = slots.size() - 1;
+        for (size_t i = home(symbol); ; i = (i + 1) & mask) {
+            if (slots[i].index == EMPTY || slots[i].symbol == symbol) return i;
+        }
+    }
+
+    void rehash(size_t slotCount);
+
+public:
+    PositionMap() : shift(32) {}
+
+    Position* find(SymbolId symbol) {
+        if (slots.empty()) return nullptr;
+        const Slot& s = slots[findSlot(symbol)];
+        return s.index == EMPTY ? nullptr : &positions[s.index];
+    }
+    const Position* find(SymbolId symbol) const {
+        return const_cast<PositionMap*>(this)->find(symbol);
+    }
+
+    int quantity(SymbolId symbol) const {
+        const Position* p = find(symbol);
+        return p ? p->quantity : 0;
+    }
+
+    // Returns the position for symbol, adding one with zero quantity if needed.
+    // The reference is valid until the next insert or erase.
+    Position& findOrInsert(SymbolId symbol);
+
+    // Returns false if there was no position for symbol
+    bool erase(SymbolId symbol);
+
+    // Makes room for count positions without further allocation
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return positions.size(); }
+    bool empty() const { return positions.empty(); }
+    const Position& operator[](size_t i) const { return positions[i]; }
+    const Position* begin() const { return positions.data(); }
+    const Position* end() const { return positions.data() + positions.size(); }
+};
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <stdexcept>
+using namespace std;
+
+// Producer and consumer state live on separate cache lines so that one side
+// writing its index does not invalidate the line the other side is reading
+static const size_t CACHE_LINE = 64;
+
+// How a thread waits for a ring to become non-empty or non-full.
+//  Spin:  busy-wait with a pause hint. Lowest latency, burns its core; only
+//         sensible with a core per spinning thread.
+//  Yield: busy-wait that gives the CPU away between checks.
+//  Block: spins briefly, then sleeps in the kernel (a futex on Linux) until
+//         the other side signals or the timeout passes.
+enum class WaitStrategy { Spin, Yield, Block };
+
+// "spin", "yield" or "block"; throws invalid_argument otherwise
+WaitStrategy parseWaitStrategy(const string& name);
+const char* waitStrategyName(WaitStrategy strategy);
+
+inline void cpuRelax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Wake-up channel for one waiting side of a ring. The state word is the
+// futex: the low bit says someone is (about to be) asleep, the rest counts
+// wake-ups. notify() clears the bit as it wakes, so while the woken thread
+// has not yet run, further notify() calls cost a fence and a load rather
+// than another system call.
+class WaitSignal {
+private:
+    static const int SPINS_BEFORE_SLEEP = 256;
+    static const uint32_t ARMED = 1;
+
+    atomic<uint32_t> state;
+
+    void sleep(uint32_t armedState, chrono::microseconds timeout);
+    void wakeAll();
+
+public:
+    WaitSignal() : state(0) {}
+
+    void notify() {
+        // Pairs with the fence in wait(): either the sleeper sees the new
+        // state of the ring when it re-checks, or we see it armed and wake it
+        atomic_thread_fence(memory_order_seq_cst);
+        uint32_t current = state.load(memory_order_relaxed);
+        while (current & ARMED) {
+            if (state.compare_exchange_weak(current, (current & ~ARMED) + 2, memory_order_release, memory_order_relaxed)) {
+                wakeAll();
+                return;
+            }
+        }
+    }
+
+    // Waits until ready() returns true or timeout passes. Returns ready().
+    template <class Ready>
+    bool wait(WaitStrategy strategy, chrono::microseconds timeout, Ready&& ready) {
+        if (ready()) return true;
+        auto deadline = chrono::steady_clock::now() + timeout;
+        for (int spins = 1; ; spins++) {
+            if (strategy == WaitStrategy::Yield) {
+                this_thread::yield();
+            } else if (strategy == WaitStrategy::Spin || spins < SPINS_BEFORE_SLEEP) {
+                cpuRelax();
+            } else {
+                auto now = chrono::steady_clock::now();
+                if (now >= deadline) return ready();
+                uint32_t current = state.load(memory_order_relaxed);
+                while (!(current & ARMED) && !state.compare_exchange_weak(current, current | ARMED, memory_order_relaxed)) {}
+                atomic_thread_fence(memory_order_seq_cst);
+                if (!ready()) {
+                    sleep(current | ARMED, chrono::duration_cast<chrono::microseconds>(deadline - now));
+                }
+            }
+            if (ready()) return true;
+            if ((spins & 63) == 0 && chrono::steady_clock::now() >= deadline) return false;
+        }
+    }
+};
+
+// Bounded single-producer single-consumer ring of fixed-size messages.
+// head and tail only ever grow; each side keeps a cached copy of the other's
+// index and only reloads it when the cached value says full (or empty), so
+// in steady state neither side touches the other's cache line.
+template <class T>
+class SpscRing {
+    static_assert(is_trivially_copyable<T>::value, "ring messages are copied slot by slot");
+
+private:
+    alignas(CACHE_LINE) atomic<uint64_t> head;   // next slot the producer writes
+    uint64_t cachedTail;
+    alignas(CACHE_LINE) atomic<uint64_t> tail;   // next slot the consumer reads
+    uint64_t cachedHead;
+    alignas(CACHE_LINE) atomic<bool> closed;
+    WaitSignal itemsReady;
+    WaitSignal spaceReady;
+    alignas(CACHE_LINE) vector<T> slots;
+    uint64_t mask;
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : head(0), cachedTail(0), tail(0), cachedHead(0), closed(false) {
+        if (capacity == 0) throw invalid_argument("Ring capacity must be positive");
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer. Copies as many of items as fit, publishes them with one
+    // store, and returns how many were taken.
+    size_t pushBatch(const T* items, size_t count) {
+        uint64_t h = head.load(memory_order_relaxed);
+        size_t space = (size_t)(slots.size() - (h - cachedTail));
+        if (space < count) {
+            cachedTail = tail.load(memory_order_acquire);
+            space = (size_t)(slots.size() - (h - cachedTail));
+        }
+        size_t n = count < space ? count : space;
+        if (n == 0) return 0;
+        for (size_t i = 0; i < n; i++) {
+            slots[(h + i) & mask] = items[i];
+        }
+        head.store(h + n, memory_order_release);
+        itemsReady.notify();
+        return n;
+    }
+
+    bool tryPush(const T& item) { return pushBatch(&item, 1) == 1; }
+
+    // Consumer. Moves up to max messages into out and returns how many.
+    size_t popBatch(T* out, size_t max) {
+        uint64_t t = tail.load(memory_order_relaxed);
+        size_t available = (size_t)(cachedHead - t);
+        if (available < max) {
+            cachedHead = head.load(memory_order_acquire);
+            available = (size_t)(cachedHead - t);
+        }
+        size_t n = max < available ? max : available;
+        if (n == 0) return 0;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = slots[(t + i) & mask];
+        }
+        tail.store(t + n, memory_order_release);
+        spaceReady.notify();
+        return n;
+    }
+
+    bool tryPop(T& out) { return popBatch(&out, 1) == 1; }
+
+    // Consumer: true once something can be popped or the ring is closed
+    bool waitForItems(WaitStrategy strategy, chrono::microseconds timeout) {
+        return itemsReady.wait(strategy, timeout, [this] {
+            return head.load(memory_order_acquire) != tail.load(memory_order_relaxed) || closed.load(memory_order_acquire);
+        });
+    }
+
+    // Producer: true once at least one slot is free
+    bool waitForSpace(WaitStrategy strategy, chrono::microseconds timeout) {
+        return spaceReady.wait(strategy, timeout, [this] {
+            return head.load(memory_order_relaxed) - tail.load(memory_order_acquire) < slots.size();
+        });
+    }
+
+    // No more pushes will come. Wakes a waiting consumer; whatever is queued
+    // can still be popped.
+    void close() {
+        closed.store(true, memory_order_release);
+        itemsReady.notify();
+    }
+    bool isClosed() const { return closed.load(memory_order_acquire); }
+
+    size_t capacity() const { return slots.size(); }
+    // Exact only when called by one of the two sides while the other is idle
+    size_t size() const { return (size_t)(head.load(memory_order_acquire) - tail.load(memory_order_acquire)); }
+    bool empty() const { return size() == 0; }
+};
+
+// Bounded multi-producer single-consumer ring. Producers claim a slot by
+// advancing head with a CAS; every slot carries a sequence number that says
+// whose turn it is (Vyukov's bounded queue), so a producer that claimed an
+// earlier slot but has not finished writing it holds back only the consumer,
+// never the other producers.
+template <class T>
+class MpscRing {
+    static_assert(is_trivially_copyable<T>::value, "ring messages are copied slot by slot");
+
+private:
+    struct Slot {
+        atomic<uint64_t> sequence;   // == position: free for the producer of that position
+        T value;                     // == position + 1: written, ready for the consumer
+    };
+
+    alignas(CACHE_LINE) atomic<uint64_t> head;   // next position a producer claims
+    alignas(CACHE_LINE) uint64_t tail;           // consumer only
+    alignas(CACHE_LINE) atomic<bool> closed;
+    WaitSignal itemsReady;
+    WaitSignal spaceReady;
+    alignas(CACHE_LINE) vector<Slot> slots;
+    uint64_t mask;
+
+    bool claim(uint64_t& position) {
+        position = head.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position & mask];
+            uint64_t sequence = slot.sequence.load(memory_order_acquire);
+            int64_t diff = (int64_t)(sequence - position);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(position, position + 1, memory_order_relaxed)) return true;
+            } else if (diff < 0) {
+                return false;   // the consumer has not freed this slot yet: full
+            } else {
+                position = head.load(memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    explicit MpscRing(size_t capacity) : head(0), tail(0), closed(false) {
+        if (capacity == 0) throw invalid_argument("Ring capacity must be positive");
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots = vector<Slot>(size);
+        for (size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        mask = size - 1;
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread. Returns how many of items were queued before the ring
+    // filled up; the consumer is signalled once for the whole batch.
+    size_t pushBatch(const T* items, size_t count) {
+        size_t n = 0;
+        uint64_t position;
+        while (n < count && claim(position)) {
+            Slot& slot = slots[position & mask];
+            slot.value = items[n++];
+            slot.sequence.store(position + 1, memory_order_release);
+        }
+        if (n) itemsReady.notify();
+        return n;
+    }
+
+    bool tryPush(const T& item) { return pushBatch(&item, 1) == 1; }
+
+    // Consumer. Stops early at a slot whose producer is still writing.
+    size_t popBatch(T* out, size_t max) {
+        size_t n = 0;
+        while (n < max) {
+            Slot& slot = slots[tail & mask];
+            if (slot.sequence.load(memory_order_acquire) != tail + 1) break;
+            out[n++] = slot.value;
+            slot.sequence.store(tail + slots.size(), memory_order_release);
+            tail++;
+        }
+        if (n) spaceReady.notify();
+        return n;
+    }
+
+    bool tryPop(T& out) { return popBatch(&out, 1) == 1; }
+
+    // Consumer: true once the next slot is ready or the ring is closed
+    bool waitForItems(WaitStrategy strategy, chrono::microseconds timeout) {
+        return itemsReady.wait(strategy, timeout, [this] {
+            return slots[tail & mask].sequence.load(memory_order_acquire) == tail + 1 || closed.load(memory_order_acquire);
+        });
+    }
+
+    // Producer: true once the slot at head is free again
+    bool waitForSpace(WaitStrategy strategy, chrono::microseconds timeout) {
+        return spaceReady.wait(strategy, timeout, [this] {
+            uint64_t position = head.load(memory_order_relaxed);
+            return slots[position & mask].sequence.load(memory_order_acquire) >= position;
+        });
+    }
+
+    void close() {
+        closed.store(true, memory_order_release);
+        itemsReady.notify();
+    }
+    bool isClosed() const { return closed.load(memory_order_acquire); }
+
+    size_t capacity() const { return slots.size(); }
+    // Consumer only: nothing is ready to pop
+    bool empty() const { return slots[tail & mask].sequence.load(memory_order_acquire) != tail + 1; }
+};
+
+#endif
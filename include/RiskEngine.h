@@ -0,0 +1,64 @@
+#ifndef RISKENGINE_H
+#define RISKENGINE_H
+
+#include <cstdint>
+#include "User.h"
+#include "OrderBook.h"
+#include "SymbolTable.h"
+#include "Money.h"
+using namespace std;
+
+// Why the pre-trade check turned an order away
+enum class RiskReject : uint8_t { None, Quantity, Cash, Shares };
+
+// Pre-trade risk checks, inline on every order path (BuyOrder, SellOrder,
+// OrderBatch, ShardedEngine).
+//
+// An order reserves everything it could need before it trades: a buy
+// limit * quantity of cash, a sell its shares. Fills are paid out of the
+// reservation (User::settleBuy/settleSell) and whatever rests on a book
+// stays reserved until it fills or is cancelled, so two open orders can
+// never spend the same cash or sell the same shares. A check compares two
+// adjacent fields of the account (balance and reserved cash, or one
+// position's quantity and reserved shares), so it is a few nanoseconds and
+// never allocates.
+class RiskEngine {
+private:
+    static uint64_t rejections[4];   // indexed by RiskReject
+
+public:
+    // Whether the account could place the order now, without reserving
+    static RiskReject check(const User& user, Side side, SymbolId symbol, int quantity, Price limit) {
+        if (quantity <= 0) return RiskReject::Quantity;
+        if (side == Side::Buy) {
+            return user.getAvailableCash() >= limit * quantity ? RiskReject::None : RiskReject::Cash;
+        }
+        return user.getAvailableShares(symbol) >= quantity ? RiskReject::None : RiskReject::Shares;
+    }
+
+    // check() and, if it passes, reserve what the order needs. Rejections
+    // are counted.
+    static RiskReject reserve(User& user, Side side, SymbolId symbol, int quantity, Price limit) {
+        RiskReject reason = RiskReject::Quantity;
+        if (quantity > 0) {
+            if (side == Side::Buy) {
+                reason = user.reserveCash(limit * quantity) ? RiskReject::None : RiskReject::Cash;
+            } else {
+                reason = user.reserveShares(symbol, quantity) ? RiskReject::None : RiskReject::Shares;
+            }
+        }
+        if (reason != RiskReject::None) rejections[(size_t)reason]++;
+        return reason;
+    }
+
+    // Hands back the reservation of quantity unfilled shares
+    static void release(User& user, Side side, SymbolId symbol, int quantity, Price limit) {
+        if (side == Side::Buy) user.releaseCash(limit * quantity);
+        else user.releaseShares(symbol, quantity);
+    }
+
+    static uint64_t rejectedCount(RiskReject reason) { return rejections[(size_t)reason]; }
+    static const char* describe(RiskReject reason);
+};
+
+#endif
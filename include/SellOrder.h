@@ -4,15 +4,18 @@
 #include "Order.h"
 using namespace std;
 
-class SellOrder : public Order {
+// final for the same reason as BuyOrder: OrderBatch calls it without a vtable lookup
+class SellOrder final : public Order {
 private:
     int sellOrderCount;
 
 public:
-    SellOrder(string sym, int q, double p);
+    SellOrder(SymbolId sym, int q, Price p, OrderType t = OrderType::Limit, TimeInForce tif = TimeInForce::GTC);
+    SellOrder(const string& sym, int q, Price p);
     ~SellOrder();
 
     bool execute(User& user, Stock& stock) override;
+    bool execute(User& user, Stock& stock, OrderBook& book) override;
     void displayDetails() const override;
 };
 
@@ -0,0 +1,149 @@
+#ifndef SHARDEDENGINE_H
+#define SHARDEDENGINE_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "User.h"
+#include "Stock.h"
+#include "OrderBook.h"
+#include "RingBuffer.h"
+using namespace std;
+
+// A limit order on its way to a shard. The cash or shares it may need have
+// already been reserved on the user's account.
+struct EngineOrder {
+    User* user;
+    SymbolId symbol;
+    Side side;
+    int quantity;
+    Price limit;
+    uint64_t id;       // 0 if the order has none
+};
+
+// What a shard reports back. Each event settles exactly one account.
+struct EngineEvent {
+    enum Type : uint8_t {
+        FILL,      // quantity traded at price; cash was reserved at limit
+        RELEASE    // quantity neither traded nor resting: release its reservation
+    };
+    Type type;
+    Side side;         // side of user's order
+    bool maker;        // FILL of an order that was resting on the book
+    SymbolId symbol;
+    User* user;
+    int quantity;
+    Price price;       // FILL only
+    Price limit;
+    uint64_t orderId;  // id of user's order, 0 if it has none
+};
+
+// Matching split across threads by symbol. Each shard thread exclusively
+// owns the books and Stock objects of its symbols; User objects are only
+// ever touched by the thread that calls submit(), the coordinator.
+//
+// Protocol for an order:
+//  1. submit() runs the pre-trade check on the coordinator, reserving the
+//     order's worst-case cost (RiskEngine::reserve: cash at limit * quantity
+//     for a buy, the shares for a sell), and queues it for the symbol's
+//     shard. Orders the account cannot cover are rejected there, so a shard
+//     never has to ask about balances.
+//  2. The shard matches against its book, then the stock's inventory, and
+//     rests the remainder, emitting FILL and RELEASE events. Fills against
+//     a resting order also produce a FILL for its owner.
+//  3. applyEvents() on the coordinator settles each event on its User:
+//     a buy pays for its shares out of the reservation, a sell hands over
+//     reserved shares for the proceeds. A resting order keeps its
+//     reservation until it trades or stop() cancels it.
+//
+// Orders reach a shard through its own SPSC ring (the coordinator is the
+// only producer) and events come back through one MPSC ring shared by all
+// shards. Both are bounded: a coordinator that finds an inbox full settles
+// events while it waits, so a shard blocked on a full event ring always
+// gets room again.
+//
+// Between submit() and drain() the shards are writing Stock::available, so
+// saving stocks is only safe after drain().
+class ShardedEngine {
+public:
+    static const size_t ROUTE_BATCH = 256;        // orders staged per shard before publishing
+    static const size_t INBOX_CAPACITY = 4096;    // orders per shard ring
+    static const size_t EVENT_CAPACITY = 16384;   // events in the shared ring
+
+private:
+    struct Shard {
+        SpscRing<EngineOrder> inbox{ INBOX_CAPACITY };
+        vector<EngineOrder> staged;       // coordinator only
+        uint64_t routed = 0;              // coordinator only
+        atomic<uint64_t> processed{0};
+        thread worker;
+    };
+
+    vector<Stock*> stocksBySymbol;        // indexed by SymbolId
+    vector<OrderBook*> books;             // indexed by SymbolId, owned
+    vector<uint32_t> shardBySymbol;
+    vector<unique_ptr<Shard>> shards;
+    MpscRing<EngineEvent> events;
+    WaitSignal progress;                  // a shard finished a batch
+    WaitStrategy waitStrategy;
+    function<void(const EngineEvent&)> onFill;
+    function<void(const EngineEvent&)> onRelease;
+    bool running;
+    uint64_t rejected;
+    uint64_t fills;
+
+    void shardLoop(Shard& shard);
+    void execute(const EngineOrder& order, vector<EngineEvent>& out);
+    void settle(const EngineEvent& event);
+    void publish(Shard& shard);
+    size_t settleArrived();
+    bool idle() const;
+
+public:
+    // Spreads the stocks' symbols over shardCount threads round-robin. Each
+    // book holds maxOrdersPerBook orders on maxLevelsPerBook price levels, as
+    // OrderBook's constructor takes them. wait is how idle shards and a
+    // coordinator facing a full ring wait.
+    ShardedEngine(const vector<Stock*>& stocks, size_t shardCount,
+                  size_t maxOrdersPerBook = OrderBook::DEFAULT_MAX_ORDERS,
+                  size_t maxLevelsPerBook = OrderBook::DEFAULT_MAX_LEVELS,
+                  WaitStrategy wait = WaitStrategy::Block);
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    void start();
+    // Drains, cancels every resting order (releasing its reservation) and joins the shards
+    void stop();
+
+    // Coordinator only. Returns false, without routing, if the symbol is not
+    // traded here or the account cannot cover the order. An order with an id
+    // (Order::nextId) rests under it, and its events carry it.
+    bool submit(User& user, Side side, SymbolId symbol, int quantity, Price limit, uint64_t id = 0);
+    // Hands staged orders to their shards without waiting
+    void flush();
+    // Settles whatever events have arrived. Returns how many.
+    size_t applyEvents();
+    // Returns once every submitted order has been processed and settled
+    void drain();
+
+    // Called on the coordinator for every FILL, after it is settled
+    void setOnFill(function<void(const EngineEvent&)> callback) { onFill = callback; }
+    // Called on the coordinator, after it is settled, for every RELEASE of a
+    // remainder the book had no room for. stop() cancelling what rests does
+    // not call it.
+    void setOnRelease(function<void(const EngineEvent&)> callback) { onRelease = callback; }
+
+    size_t shardCount() const { return shards.size(); }
+    WaitStrategy getWaitStrategy() const { return waitStrategy; }
+    uint32_t shardOf(SymbolId symbol) const { return shardBySymbol[symbol]; }
+    // Only stable while drained
+    const OrderBook* bookFor(SymbolId symbol) const { return symbol < books.size() ? books[symbol] : nullptr; }
+    uint64_t rejectedCount() const { return rejected; }
+    uint64_t fillCount() const { return fills; }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "User.h"
+#include "UserDirectory.h"
+#include "Stock.h"
+using namespace std;
+
+// Fixed-width records of a snapshot file. They are read in place from the
+// mapping, so the layout must not change without bumping Snapshot::VERSION.
+struct SnapshotString {
+    uint32_t offset;       // into the string table
+    uint32_t length;
+};
+
+struct SnapshotStock {
+    uint32_t symbol;       // index into the symbol section
+    int32_t available;
+    int64_t price;         // Price::raw()
+};
+static_assert(sizeof(SnapshotStock) == 16, "SnapshotStock layout changed");
+
+struct SnapshotUser {
+    SnapshotString name;
+    int64_t balance;       // Money::raw()
+    uint32_t firstPosition;
+    uint32_t positionCount;
+};
+static_assert(sizeof(SnapshotUser) == 24, "SnapshotUser layout changed");
+
+struct SnapshotPosition {
+    uint32_t symbol;       // index into the symbol section
+    int32_t quantity;
+};
+static_assert(sizeof(SnapshotPosition) == 8, "SnapshotPosition layout changed");
+
+// Binary image of every account and stock, for fast startup and shutdown.
+//
+// A header with the offset and record count of each section, then the
+// sections, each starting on an 8-byte boundary:
+//   STRINGS    symbol names and user names, back to back
+//   SYMBOLS    one SnapshotString per symbol; records refer to symbols by
+//              their index here, which is their SymbolId when saved
+//   STOCKS     SnapshotStock
+//   USERS      SnapshotUser, in id order
+//   POSITIONS  SnapshotPosition, each user's run contiguous
+//
+// Saving builds each section in memory and writes it with one fwrite.
+// Loading maps the file once and reads the records where they lie; the only
+// fixups are turning string offsets into string_views and snapshot symbol
+// indexes into this process's SymbolIds. Reserved cash and shares are not
+// saved, as in users.txt: nothing is resting after a restart.
+class Snapshot {
+public:
+    static const uint32_t MAGIC = 0x50414E53;   // "SNAP"
+    static const uint32_t VERSION = 1;
+
+    enum Section { STRINGS, SYMBOLS, STOCKS, USERS, POSITIONS, SECTION_COUNT };
+
+private:
+    struct SectionEntry {
+        uint64_t offset;   // from the start of the file
+        uint64_t count;    // records, or bytes for STRINGS
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sectionCount;
+        uint32_t reserved;
+        uint64_t fileSize;
+        SectionEntry sections[SECTION_COUNT];
+    };
+
+public:
+    // Writes users and stocks to path through a temporary file renamed into
+    // place, so a crash mid-save leaves the previous snapshot. Returns the
+    // size of the file. Throws ios_base::failure if it cannot be written.
+    static size_t save(const string& path, const UserDirectory& users, const vector<Stock*>& stocks);
+
+    // Adds every account and stock in the snapshot to users (which must be
+    // empty) and stocks. Returns false if there is no file at path. Throws
+    // runtime_error for a damaged or foreign file, after taking back
+    // everything it added.
+    static bool load(const string& path, UserDirectory& users, vector<Stock*>& stocks);
+};
+
+#endif
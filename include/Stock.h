@@ -3,33 +3,62 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <fstream>
+#include <vector>
+#include "SymbolTable.h"
+#include "Money.h"
+#include "DelimScanner.h"
 using namespace std;
 
+// Told about every Stock::updatePrice, after the price has changed
+class PriceListener {
+public:
+    virtual ~PriceListener() {}
+    virtual void onPriceChange(SymbolId symbol, Price price) = 0;
+};
+
 struct Stock {
-    string symbol;
-    double price;
+    SymbolId symbol;
+    Price price;
     int available;
+    bool dirty;   // changed since the last flush
 
     Stock();
-    Stock(string s, double p, int a);
+    Stock(SymbolId s, Price p, int a);
+    Stock(const string& s, Price p, int a);
+    Stock(const string& s, double p, int a);
+    ~Stock();
+
+    const string& getSymbolName() const { return SymbolTable::name(symbol); }
 
     void display() const;
-    void updatePrice(double newPrice);
+    void updatePrice(Price newPrice);
     
-    double getMarketCap() const {
+    Money getMarketCap() const {
         return price * available;
     }
 
     static int totalStocks;
     static void showTotalStocks();
+
+    // One listener for every stock (null for none)
+    static PriceListener* priceListener;
+
+    // Change tracking for incremental saves. Call markDirty() after
+    // changing price or available directly.
+    static vector<Stock*> dirtyStocks;
+    void markDirty();
+    static void clearDirtyStocks();
     
     // File I/O methods
     void saveToFile(ofstream& file) const;
-    static Stock loadFromFile(string line);
+    // Parses one SYMBOL|price|available record
+    static Stock loadFromFile(string_view line);
+    static Stock loadFromRecord(const DelimRecord& record);
 
     // Simple operators for sorting and equality (by symbol)
-    bool operator<(const Stock& other) const noexcept { return symbol < other.symbol; }
+    bool operator<(const Stock& other) const noexcept { return getSymbolName() < other.getSymbolName(); }
     bool operator==(const Stock& other) const noexcept { return symbol == other.symbol; }
 
     // Printing
@@ -0,0 +1,34 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+
+typedef uint32_t SymbolId;
+
+// Global ticker table. Tickers are interned once at the I/O edge (loading
+// files, reading input) and everything on the trading path passes the dense
+// id around instead, so per-symbol data can live in plain arrays indexed by it.
+// The map's keys view the names in the deque, which never moves them, so
+// looking a ticker up does not build a string.
+class SymbolTable {
+private:
+    static deque<string> names;
+    static unordered_map<string_view, SymbolId> ids;
+
+public:
+    static const SymbolId INVALID = 0xFFFFFFFFu;
+
+    // Returns the existing id or assigns the next one
+    static SymbolId intern(string_view symbol);
+    // Returns INVALID for tickers that were never interned
+    static SymbolId find(string_view symbol);
+    static const string& name(SymbolId id);
+    static size_t size() { return names.size(); }
+};
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef TRADEJOURNAL_H
+#define TRADEJOURNAL_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <cstddef>
+#include "SymbolTable.h"
+#include "Money.h"
+#include "OrderBook.h"
+#include "DelimScanner.h"
+using namespace std;
+
+// What a journal slot holds; kept in the same byte of every record type
+enum class JournalKind : uint8_t { Trade, UserName, SymbolName };
+
+// Fixed-size on-disk trade record. Written and read as raw bytes, so the
+// layout must not change without bumping TradeJournal::VERSION.
+struct TradeRecord {
+    uint64_t sequence;
+    int64_t timestampNs;   // nanoseconds since the Unix epoch
+    uint32_t userId;       // the journal's id for the user, see NameRecord
+    uint32_t symbol;       // the journal's id for the symbol, see NameRecord
+    int32_t quantity;
+    uint8_t side;          // 0 = buy, 1 = sell
+    JournalKind kind;      // Trade
+    uint8_t maker;         // 1 for the resting order's side of a book fill
+    uint8_t reserved;
+    int64_t price;         // Price::raw()
+};
+static_assert(sizeof(TradeRecord) == 40, "TradeRecord layout changed");
+
+// Gives a user or symbol name its journal id. Takes one record slot, and
+// the name follows in as many more slots as it needs. A name is written
+// just before the first trade that uses it, so the journal is read back
+// without any table from the run that wrote it.
+struct NameRecord {
+    uint64_t sequence;     // 0: not a trade
+    uint32_t id;           // journal id being defined, counted per kind from 0
+    uint32_t length;       // bytes of name in the following slots
+    uint8_t unused[13];
+    JournalKind kind;      // UserName or SymbolName
+    uint8_t reserved[10];
+};
+static_assert(sizeof(NameRecord) == sizeof(TradeRecord), "NameRecord layout changed");
+static_assert(offsetof(NameRecord, kind) == offsetof(TradeRecord, kind), "NameRecord layout changed");
+
+// A journal trade with its names resolved for this run. user is valid only
+// for the duration of the visit; userId is the journal's own id for it.
+struct JournalTrade {
+    uint64_t sequence;
+    int64_t timestampNs;
+    uint32_t userId;
+    string_view user;
+    SymbolId symbol;       // interned in this process's SymbolTable
+    Side side;
+    int quantity;
+    Price price;
+    bool maker;            // the resting order's side of a book fill
+};
+
+// One TYPE|user|SYMBOL|qty|price|date line of trades.txt, with |MAKER after
+// the date for the resting order's side of a book fill. The string_views
+// point into the scanned buffer.
+struct TradeText {
+    Side side;
+    string_view user;
+    SymbolId symbol;
+    int quantity;
+    Price price;
+    string_view date;
+    bool maker;
+};
+
+// Append-only binary trade log. The current segment stays open and records
+// are copied into an in-memory buffer that is written out when full, so
+// logging a trade is a memcpy plus a clock read. Segments roll over once
+// they reach segmentBytes and are named trades-000001.bin, trades-000002.bin...
+//
+// Records name users and symbols by ids of the journal's own, defined by
+// NameRecords in the journal, never by ids that only mean something in the
+// run that wrote them (directory slots, SymbolTable interning order). The
+// writer maps the caller's ids to journal ids through small caches, so a
+// trade by a known user in a known symbol writes no name.
+class TradeJournal {
+public:
+    static const uint32_t MAGIC = 0x4C4E524A;   // "JRNL"
+    static const uint32_t VERSION = 2;
+
+private:
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t reserved;
+    };
+
+    string directory;
+    size_t segmentBytes;
+    vector<char> buffer;
+    size_t buffered;
+    FILE* segment;
+    uint32_t segmentNumber;
+    size_t segmentSize;
+    uint64_t nextSequence;
+
+    // Names defined so far, by journal id, and the other way round
+    vector<string> userNames;
+    unordered_map<string, uint32_t> userIds;
+    unordered_map<string, uint32_t> symbolIds;
+    // The caller's ids to journal ids, NO_ID where not yet known. A cached
+    // user id is checked against the name, as directory ids are reused.
+    vector<uint32_t> userCache;
+    vector<uint32_t> symbolCache;
+
+    static constexpr uint32_t NO_ID = 0xFFFFFFFFu;
+
+    string segmentPath(uint32_t number) const;
+    void openSegment(uint32_t number);
+    void writeBuffer();
+    // Makes room for bytes more in the current segment, rolling it over if full
+    void reserveSpace(size_t bytes);
+    void put(const void* data, size_t bytes);
+    uint32_t defineName(JournalKind kind, const string& name, uint32_t id);
+    uint32_t journalUser(uint32_t userId, const string& name);
+    uint32_t journalSymbol(SymbolId symbol);
+    void forgetNames();
+
+    // forEachTrade() that also reports each name as it is defined
+    static size_t forEachTrade(const string& dir, const function<void(const JournalTrade&)>& visit,
+                               const function<void(JournalKind, uint32_t, string_view)>& onName);
+
+public:
+    TradeJournal(string dir, size_t maxSegmentBytes = 64u << 20, size_t bufferBytes = 64u << 10);
+    ~TradeJournal();
+
+    TradeJournal(const TradeJournal&) = delete;
+    TradeJournal& operator=(const TradeJournal&) = delete;
+
+    // Opens (or creates) the journal and resumes after the last record on disk
+    void open();
+    bool isOpen() const { return segment != nullptr; }
+
+    // Returns the record's sequence number. userId is the caller's id for the
+    // user (its directory id) and only keys the cache of journal ids; the
+    // name is what the journal keeps. maker marks the resting order's side
+    // of a book fill.
+    uint64_t append(uint32_t userId, const string& userName, SymbolId symbol, Side side, int quantity, Price price,
+                    bool maker = false);
+    void flush();
+    void close();
+
+    // Deletes every segment and starts again from sequence 1
+    void clear();
+
+    uint64_t recordCount() const { return nextSequence - 1; }
+
+    // Reads every trade in sequence order from the segments in a directory.
+    // Throws runtime_error for a segment this build cannot read.
+    static size_t forEachTrade(const string& dir, const function<void(const JournalTrade&)>& visit);
+
+    // Writes trades as TYPE|user|SYMBOL|qty|price|YYYY-MM-DD lines (trades.txt
+    // format), ending in |MAKER for a maker's side
+    static size_t exportText(const string& dir, ostream& out);
+
+    // Parses one trades.txt line. Returns false if it is malformed. resolve
+    // maps the ticker to an id; pass SymbolTable::find from threads that must
+    // not modify the table (unknown tickers then come back as INVALID).
+    static bool parseText(const DelimRecord& record, TradeText& out,
+                          SymbolId (*resolve)(string_view) = SymbolTable::intern);
+
+    static int64_t nowNanos();
+};
+
+#endif
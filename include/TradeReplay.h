@@ -0,0 +1,97 @@
+#ifndef TRADEREPLAY_H
+#define TRADEREPLAY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include "User.h"
+#include "UserDirectory.h"
+#include "Stock.h"
+#include "PositionMap.h"
+#include "Money.h"
+using namespace std;
+
+// What the trade history says happened to one user
+struct ReplayedUser {
+    Money cashFlow;          // proceeds of sells minus cost of buys
+    PositionMap positions;   // net shares bought per symbol
+    uint64_t trades = 0;
+};
+
+// One row of the per-symbol inventory table
+struct SymbolAudit {
+    SymbolId symbol;
+    int64_t replayed;    // net shares users bought, per the history
+    int64_t held;        // shares users hold, per users.txt
+    int available;       // per stocks.txt, or -1 if the symbol is not listed
+};
+
+struct AuditReport {
+    size_t trades = 0;            // history lines and journal records replayed
+    size_t journalTrades = 0;     // of which came from the binary journal
+    size_t malformed = 0;
+    size_t unknownSymbols = 0;    // trades in tickers no loaded stock or user knows
+    size_t usersReplayed = 0;
+    size_t usersChecked = 0;
+    size_t issueCount = 0;
+    vector<string> issues;        // the first MAX_LISTED_ISSUES, sorted
+    vector<SymbolAudit> symbols;
+    unsigned threads = 0;
+    double seconds = 0;
+
+    bool clean() const { return issueCount == 0 && malformed == 0 && unknownSymbols == 0; }
+    void display() const;
+};
+
+// Rebuilds account state from the trade history and compares it with the
+// loaded users and stocks.
+//
+// trades.txt is split into one chunk per thread at line boundaries and
+// every thread parses its chunk into per-user totals, filed under one of
+// `threads` partitions by a hash of the user name. Each partition is then
+// merged by its own thread, so no two threads ever touch the same user and
+// nothing is locked. Totals are sums, so the order the chunks finish in
+// does not matter.
+//
+// Users start with cash only and deposits are not logged, so what can be
+// checked is:
+//  - holdings in users.txt equal the net shares the history gives them
+//  - the history never pays a user more than their balance now holds
+//    (balance - cash flow is what they deposited, and cannot be negative)
+//  - per symbol, shares held across users.txt equal the net shares the
+//    history moved to users, and every traded symbol is a listed stock
+class TradeReplay {
+public:
+    static const size_t MAX_LISTED_ISSUES = 50;
+    static const size_t MIN_CHUNK_BYTES = 1 << 20;   // smaller histories use fewer threads
+
+private:
+    unsigned threadCount;
+    vector<unordered_map<string_view, ReplayedUser>> partitions;
+    deque<string> journalNames;    // keeps user names from the journal alive
+    vector<int64_t> netBought;     // indexed by SymbolId
+    AuditReport report;
+
+    size_t partitionOf(string_view user) const { return hash<string_view>()(user) % partitions.size(); }
+
+public:
+    // threads = 0 uses every hardware thread
+    explicit TradeReplay(unsigned threads = 0);
+
+    // Replays trades.txt contents. The text must outlive this object: user
+    // names are kept as views into it.
+    void replayText(string_view text);
+
+    // Replays trades still in the binary journal, which names its users
+    void replayJournal(const string& dir);
+
+    // Compares the replayed totals with users and stocks and returns the report
+    AuditReport verify(const UserDirectory& users, const vector<Stock*>& stocks);
+
+    // Replayed totals for a user, or null if the history never mentions them
+    const ReplayedUser* find(string_view user) const;
+};
+
+#endif
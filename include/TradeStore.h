@@ -0,0 +1,101 @@
+#ifndef TRADESTORE_H
+#define TRADESTORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "SymbolTable.h"
+#include "Money.h"
+#include "OrderBook.h"
+#include "TradeJournal.h"
+using namespace std;
+
+// Half-open time window in nanoseconds since the Unix epoch
+struct TimeRange {
+    int64_t from;
+    int64_t to;
+
+    static TimeRange all() { return { INT64_MIN, INT64_MAX }; }
+    bool contains(int64_t t) const { return t >= from && t < to; }
+};
+
+// Aggregates over a set of trades. Each execution counts once, on the side
+// of the order that took liquidity, so the imbalance says which side did.
+struct TradeTotals {
+    uint64_t trades = 0;
+    int64_t buyVolume = 0;
+    int64_t sellVolume = 0;
+    Money notional;          // sum of quantity * price
+
+    int64_t volume() const { return buyVolume + sellVolume; }
+    // Volume-weighted average price, zero when nothing traded
+    Price vwap() const { return volume() ? Price::fromUnits(notional.raw() / volume()) : Price(); }
+    // (buy - sell) / (buy + sell), in [-1, 1]
+    double imbalance() const { return volume() ? (double)(buyVolume - sellVolume) / (double)volume() : 0.0; }
+
+    TradeTotals& operator+=(const TradeTotals& other);
+};
+
+// Trades kept column by column. A query that needs the symbol, quantity
+// and price of every trade streams exactly those three arrays instead of
+// whole records (let alone text lines), and the columns are laid out for
+// the AVX2 kernels in TradeStore.cpp, which test four trades per step.
+//
+// Rows are in the order they were added: the history first, then anything
+// appended live, so timestamps are ordered as far as the sources are.
+// There is a row per account, so a book fill has two: the incoming order's
+// and the resting order's, flagged as the maker's. The aggregates skip
+// maker rows.
+class TradeStore {
+public:
+    static const uint32_t UNKNOWN_USER = 0xFFFFFFFFu;
+    static constexpr uint8_t SELL = 1, MAKER = 2;   // bits of a sides entry
+
+private:
+    vector<int64_t> timestamps;   // ns since the epoch
+    vector<uint32_t> userIds;
+    vector<SymbolId> symbols;
+    vector<uint8_t> sides;        // bit 0: sell (TradeRecord::side), bit 1: maker
+    vector<int32_t> quantities;
+    vector<int64_t> prices;       // Price::raw()
+
+public:
+    void reserve(size_t rows);
+    void clear();
+
+    void append(int64_t timestampNs, uint32_t userId, SymbolId symbol, Side side, int quantity, Price price,
+                bool maker = false);
+
+    // Appends every well-formed trades.txt line, timestamped at midnight UTC
+    // of its date. userIdOf maps a name to its id (UNKNOWN_USER if none).
+    // Returns the rows added; skipped counts the malformed lines.
+    size_t loadText(string_view text, const function<uint32_t(string_view)>& userIdOf, size_t& skipped);
+    // Appends every trade of the binary journal in a directory. userIdOf
+    // maps a name to its id (UNKNOWN_USER if none), as for loadText.
+    size_t loadJournal(const string& dir, const function<uint32_t(string_view)>& userIdOf);
+
+    size_t size() const { return timestamps.size(); }
+    bool empty() const { return timestamps.empty(); }
+
+    // One symbol's trades within range
+    TradeTotals totals(SymbolId symbol, TimeRange range = TimeRange::all()) const;
+    // Every symbol's trades within range; out is indexed by SymbolId
+    void totalsBySymbol(vector<TradeTotals>& out, TimeRange range = TimeRange::all()) const;
+    // Row numbers of the trades within range, in order
+    void selectRange(TimeRange range, vector<uint32_t>& rows) const;
+
+    int64_t timestampAt(size_t row) const { return timestamps[row]; }
+    uint32_t userIdAt(size_t row) const { return userIds[row]; }
+    SymbolId symbolAt(size_t row) const { return symbols[row]; }
+    Side sideAt(size_t row) const { return (sides[row] & SELL) ? Side::Sell : Side::Buy; }
+    bool isMakerAt(size_t row) const { return (sides[row] & MAKER) != 0; }
+    int quantityAt(size_t row) const { return quantities[row]; }
+    Price priceAt(size_t row) const { return Price::fromUnits(prices[row]); }
+
+    // "avx2" or "scalar"
+    static const char* implementation();
+};
+
+#endif
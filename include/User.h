@@ -3,53 +3,112 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
+#include "SymbolTable.h"
+#include "Money.h"
+#include "DelimScanner.h"
+#include "PositionMap.h"
 using namespace std;
 
 enum TransactionType { BUY, SELL, DEPOSIT };
 
 struct Transaction {
     TransactionType type;
-    string symbol;
+    SymbolId symbol;
     int quantity;
-    double amount;
+    Money amount;
+};
+
+class User;
+
+// Told about every change to an account's cash and about every fill that
+// moves shares in or out of it (reservations are neither), after the fact
+class AccountListener {
+public:
+    virtual ~AccountListener() {}
+    virtual void onCashChange(User& user, Money delta) = 0;
+    // shares is negative for a sale
+    virtual void onFill(User& user, SymbolId symbol, int shares, Price price) = 0;
 };
 
 class User {
 private:
     string name;
-    double balance;
-    vector<pair<string, int>> stocks;  // symbol and quantity pairs
+    Money balance;
+    Money reserved;                      // of balance, held back for open buy orders
+    PositionMap positions;               // quantity held per symbol
+    bool dirty;                          // changed since the last flush
     static int totalUsers;
+    static vector<User*> dirtyUsers;
+    static AccountListener* listener;
 
-    void recordTransaction(string symbol, int qty, double amount);
+    void changeBalance(Money delta);
+    void notifyFill(SymbolId symbol, int shares, Price price);
+    void recordTransaction(SymbolId symbol, int qty, Money amount);
 
 public:
     User();
+    User(string userName, Money initialBalance);
     User(string userName, double initialBalance);
+    User(const User& other);
+    User& operator=(const User& other);
     ~User();
 
-    void addBalance(double amount);
-    bool buyStock(string symbol, int quantity, double price);
-    bool sellStock(string symbol, int quantity, double price);
+    void addBalance(Money amount);
+    bool buyStock(SymbolId symbol, int quantity, Price price);
+    bool sellStock(SymbolId symbol, int quantity, Price price);
     void viewPortfolio() const;
+
+    // Reservations for orders that can still trade: resting on a book or
+    // routed to a ShardedEngine shard (see RiskEngine). Reserved cash and
+    // shares stay in the account but cannot back another order; a fill uses
+    // them up through settleBuy/settleSell and release* hands back the rest.
+    bool reserveCash(Money amount);                    // false if less is free
+    void releaseCash(Money amount);
+    bool reserveShares(SymbolId symbol, int quantity); // false if fewer are free
+    void releaseShares(SymbolId symbol, int quantity);
+    // A buy fill of an order that reserved limit per share: pays price per share
+    void settleBuy(SymbolId symbol, int quantity, Price price, Price limit);
+    // A sell fill of reserved shares: proceeds arrive
+    void settleSell(SymbolId symbol, int quantity, Price price);
+
+    Money getAvailableCash() const { return balance - reserved; }
+    Money getReservedCash() const { return reserved; }
+    int getAvailableShares(SymbolId symbol) const {
+        const Position* p = positions.find(symbol);
+        return p ? p->quantity - p->reserved : 0;
+    }
     
-    string getName() const;
-    double getBalance() const;
-    vector<pair<string, int>>& getStocks();
+    const string& getName() const;
+    Money getBalance() const;
+    const PositionMap& getPositions() const;
     
     static int getTotalUsers();
     static void displayStats();
+
+    // One listener for every account (null for none)
+    static void setListener(AccountListener* l) { listener = l; }
+
+    // Change tracking for incremental saves
+    void markDirty();
+    bool isDirty() const { return dirty; }
+    static vector<User*>& getDirtyUsers() { return dirtyUsers; }
+    static void clearDirtyUsers();
     
     // File I/O methods
     void saveToFile(ofstream& file) const;
-    static User loadFromFile(string line);
+    // Parses one name|balance|SYM:qty,SYM:qty record
+    static User loadFromFile(string_view line);
+    static User loadFromRecord(const DelimRecord& record);
     
     // Adjust balance easily
-    User& operator+=(double amount) noexcept;
+    User& operator+=(Money amount) noexcept;
 
     friend ostream& operator<<(ostream& os, const User& u);
+    // Rebuilds positions from its fixed-width records
+    friend class Snapshot;
 };
 
 #endif
@@ -0,0 +1,188 @@
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include <string_view>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include "User.h"
+#include "DelimScanner.h"
+#include "ObjectPool.h"
+using namespace std;
+
+// Generational reference to an account; index is the account's id
+typedef PoolHandle UserHandle;
+
+// Every account, stored in place and indexed by name.
+//
+// Users live in slots of fixed-size chunks: a chunk holds CHUNK_SIZE users
+// side by side and is never moved or freed while the directory lives, so
+// adding an account is a placement-new (no allocation per user) and a User*
+// stays valid for the account's lifetime, which the order books and the
+// valuation rely on. A slot's index is the account's id; removed slots are
+// reused with a new generation, so a handle to a removed account is refused
+// rather than resolving to its successor.
+//
+// Names are found through an open-addressing table of {hash, id} slots with
+// linear probing (the layout PositionMap uses for symbols): a lookup compares
+// 32-bit hashes and touches a User only on a hash match. The table is kept
+// at most three quarters full and never shrinks. A name is the account's
+// key for as long as it is in the directory, so it must not change there.
+class UserDirectory {
+public:
+    static constexpr uint32_t CHUNK_SIZE = 1024;
+
+private:
+    static constexpr uint32_t CHUNK_BITS = 10;
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+
+    struct Slot {
+        union {
+            alignas(User) unsigned char object[sizeof(User)];
+            uint32_t nextFree;   // while the slot is free
+        };
+        uint32_t generation;     // odd while an account is live
+    };
+
+    struct IndexSlot {
+        uint32_t hash;
+        uint32_t id;             // EMPTY if the slot is free
+    };
+
+    vector<unique_ptr<Slot[]>> chunks;
+    uint32_t slotCount;          // slots ever handed out; ids are below this
+    uint32_t freeHead;
+    uint32_t liveCount;
+    vector<IndexSlot> index;     // size is zero or a power of two
+
+    Slot& slotAt(uint32_t id) const { return chunks[id >> CHUNK_BITS][id & (CHUNK_SIZE - 1)]; }
+    static User* objectIn(Slot& slot) { return reinterpret_cast<User*>(slot.object); }
+
+    static uint32_t hashName(string_view name) { return (uint32_t)hash<string_view>()(name); }
+    // Slot holding name, or the empty slot where it would go
+    size_t findIndexSlot(string_view name, uint32_t h) const;
+    void rehash(size_t size);
+    void eraseIndex(size_t hole);
+    void addChunk();
+    // Free id to build the next account in; only insert() claims it
+    uint32_t takeSlot();
+    // Builds make()'s User straight into a free slot. A name already taken
+    // throws, or with replace has the new record copied over the old account.
+    template <class Make>
+    UserHandle insert(Make&& make, bool replace);
+
+public:
+    UserDirectory();
+    ~UserDirectory();
+
+    UserDirectory(const UserDirectory&) = delete;
+    UserDirectory& operator=(const UserDirectory&) = delete;
+
+    // Adds an account built from args (as for User's constructors). Throws
+    // invalid_argument if the name is already taken.
+    template <class... Args>
+    UserHandle create(Args&&... args) {
+        return insert([&] { return User(std::forward<Args>(args)...); }, false);
+    }
+
+    // Adds the account make() returns, built straight into its slot. Throws
+    // invalid_argument if the name is already taken.
+    template <class Make>
+    UserHandle emplace(Make&& make) {
+        return insert(make, false);
+    }
+
+    // Adds the account in a users.txt record, or for a name already here
+    // (a newer record of a known user) overwrites that account in place
+    UserHandle load(const DelimRecord& record) {
+        return insert([&] { return User::loadFromRecord(record); }, true);
+    }
+
+    // Destroys the account and frees its id. Returns false if the handle is stale.
+    bool remove(UserHandle handle);
+
+    // Null for a stale handle, a free id or an unknown name
+    User* get(UserHandle handle) const;
+    User* find(uint32_t id) const;
+    User* find(string_view name) const;
+    UserHandle handleOf(uint32_t id) const;
+    UserHandle handleOf(string_view name) const;
+    // id of the account, which must be in this directory
+    uint32_t idOf(const User& user) const;
+
+    // Destroys every account; ids start again from 0
+    void clear();
+    // Makes room for count accounts so that adding them allocates nothing
+    void reserve(size_t count);
+
+    size_t size() const { return liveCount; }
+    bool empty() const { return liveCount == 0; }
+    // Every id is below this, live or not
+    uint32_t idLimit() const { return slotCount; }
+
+    // Calls fn(id, user) for every account in id order, chunk by chunk
+    template <class Fn>
+    void forEach(Fn&& fn) const;
+};
+
+template <class Make>
+UserHandle UserDirectory::insert(Make&& make, bool replace) {
+    // Grown first, so nothing after the User is built can throw but the
+    // duplicate-name check
+    if ((liveCount + 1) * 4 > index.size() * 3) {
+        rehash(index.empty() ? 16 : index.size() * 2);
+    }
+    uint32_t id = takeSlot();
+    Slot& slot = slotAt(id);
+    uint32_t next = slot.nextFree;
+    User* user;
+    try {
+        user = new (slot.object) User(make());
+    } catch (...) {
+        // make() builds straight into the slot, so a throw partway (a bad
+        // users.txt line) may have overwritten the free-list link
+        slot.nextFree = next;
+        throw;
+    }
+
+    uint32_t h = hashName(user->getName());
+    size_t at = findIndexSlot(user->getName(), h);
+    if (index[at].id != EMPTY) {
+        uint32_t known = index[at].id;
+        try {
+            if (replace) *objectIn(slotAt(known)) = *user;
+        } catch (...) {
+            user->~User();
+            slot.nextFree = next;
+            throw;
+        }
+        user->~User();
+        slot.nextFree = next;
+        if (!replace) throw invalid_argument("A user with that name already exists");
+        return handleOf(known);
+    }
+    index[at] = { h, id };
+
+    if (id == slotCount) slotCount++;
+    else freeHead = next;
+    slot.generation++;
+    liveCount++;
+    return { id, slot.generation };
+}
+
+template <class Fn>
+void UserDirectory::forEach(Fn&& fn) const {
+    for (uint32_t base = 0; base < slotCount; base += CHUNK_SIZE) {
+        Slot* chunk = chunks[base >> CHUNK_BITS].get();
+        uint32_t count = min(CHUNK_SIZE, slotCount - base);
+        for (uint32_t i = 0; i < count; i++) {
+            if (chunk[i].generation & 1) fn(base + i, *objectIn(chunk[i]));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef VALUATION_H
+#define VALUATION_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "User.h"
+#include "Stock.h"
+#include "SymbolTable.h"
+#include "Money.h"
+using namespace std;
+
+// One account's shares of one symbol, as the valuation sees them
+struct Holding {
+    uint32_t account;
+    int quantity;
+    Money cost;          // what the shares held cost, at average cost
+};
+
+// Mark-to-market valuation of every tracked account, kept up to date as
+// things happen instead of recomputed on demand.
+//
+// Each symbol has a list of its holders. A price tick walks only that list,
+// adding (new - old mark) * quantity to each holder's market value, so it
+// costs O(holders of the symbol). Book totals (cash, market value, cost) are
+// running sums, so whole-book equity is read in O(1).
+//
+// Fills arrive through AccountListener: bought shares add their price to
+// the cost basis, sold shares take out their share of it at average cost.
+// Positions an account already holds when it is tracked have no purchase
+// price on file, so their cost basis is the mark at that moment. A symbol
+// with no quote is marked at its first fill. Cash and shares reserved for
+// open orders are still the account's and count as held.
+class Valuation : public AccountListener, public PriceListener {
+private:
+    struct Account {
+        User* user;
+        Money marketValue;
+        Money cost;
+    };
+
+    vector<Account> accounts;
+    unordered_map<const User*, uint32_t> accountOf;
+    vector<vector<Holding>> holders;          // by SymbolId
+    unordered_map<uint64_t, uint32_t> slotOf; // (account, symbol) -> index into holders[symbol]
+    vector<Price> marks;                      // by SymbolId, zero until quoted
+    vector<int64_t> sharesHeld;               // by SymbolId, across accounts
+    Money cashTotal;
+    Money marketValueTotal;
+    Money costTotal;
+
+    static uint64_t slotKey(uint32_t account, SymbolId symbol) { return (uint64_t)account << 32 | symbol; }
+
+    void ensureSymbol(SymbolId symbol);
+    void addShares(uint32_t account, SymbolId symbol, int quantity, Price price);
+    void removeShares(uint32_t account, SymbolId symbol, int quantity);
+    const Account* find(const User& user) const;
+
+public:
+    // Starts valuing an account with its current balance and positions
+    void track(User& user);
+    void setMark(SymbolId symbol, Price price) { onPriceChange(symbol, price); }
+
+    void onCashChange(User& user, Money delta) override;
+    void onFill(User& user, SymbolId symbol, int shares, Price price) override;
+    void onPriceChange(SymbolId symbol, Price price) override;
+
+    // Per account, zero for an account not tracked
+    Money marketValue(const User& user) const;
+    Money costBasis(const User& user) const;
+    Money unrealized(const User& user) const { return marketValue(user) - costBasis(user); }
+    Money equity(const User& user) const { return user.getBalance() + marketValue(user); }
+    // Null if the account holds none of symbol
+    const Holding* holding(const User& user, SymbolId symbol) const;
+
+    Price mark(SymbolId symbol) const { return symbol < marks.size() ? marks[symbol] : Price(); }
+    size_t holderCount(SymbolId symbol) const { return symbol < holders.size() ? holders[symbol].size() : 0; }
+    size_t accountCount() const { return accounts.size(); }
+
+    // Whole book
+    Money totalCash() const { return cashTotal; }
+    Money totalMarketValue() const { return marketValueTotal; }
+    Money totalEquity() const { return cashTotal + marketValueTotal; }
+    Money totalUnrealized() const { return marketValueTotal - costTotal; }
+};
+
+#endif
@@ -1,18 +1,65 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
-#include <ctime>
 #include <cmath>
 #include <stdexcept>
 #include <limits>
+#include <ctime>
+#include <iomanip>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
 #include "include/User.h"
 #include "include/Stock.h"
 #include "include/BuyOrder.h"
 #include "include/SellOrder.h"
+#include "include/OrderBook.h"
+#include "include/SymbolTable.h"
+#include "include/Money.h"
+#include "include/TradeJournal.h"
+#include "include/Persistence.h"
+#include "include/MappedFile.h"
+#include "include/DelimScanner.h"
+#include "include/Log.h"
+#include "include/ObjectPool.h"
+#include "include/Config.h"
+#include "include/TradeReplay.h"
+#include "include/TradeStore.h"
+#include "include/BarBuilder.h"
+#include "include/Valuation.h"
+#include "include/RiskEngine.h"
+#include "include/UserDirectory.h"
+#include "include/OrderBatch.h"
+#include "include/OrderIndex.h"
+#include "include/ShardedEngine.h"
 using namespace std;
 
-vector<User*> users;
+UserDirectory users;                    // every account; menu number is id + 1
 vector<Stock*> stocks;
+vector<OrderBook*> books;   // indexed by SymbolId, null for symbols with no stock
+vector<Stock*> stocksBySymbol;          // `stocks` indexed by SymbolId, like `books`
+OrderIndex openOrders;                  // every resting order on `books`, by order id
+TradeJournal journal("data/journal");   // binary log of trades since the last export
+Persistence persistence("data");        // snapshot and change logs for users and stocks
+TradeStore tradeStore;                  // every trade, column by column, for statistics
+BarBuilder bars;                        // OHLCV bars of live trades, completed ones saved to data/bars.txt
+Valuation valuation;                    // every account marked to the stocks' prices
+
+// Pools sized from data/config.txt at startup; orders never come from the heap
+ObjectPool<BuyOrder>* buyOrders = nullptr;
+ObjectPool<SellOrder>* sellOrders = nullptr;
+size_t bookOrdersPerSymbol = OrderBook::DEFAULT_MAX_ORDERS;
+size_t bookLevelsPerSymbol = OrderBook::DEFAULT_MAX_LEVELS;
+size_t batchCommitOrders = 100000;      // --batch saves after this many orders
+
+// Gives a pooled order back when the menu action ends, however it ends
+template <class T>
+struct PooledOrder {
+    ObjectPool<T>& pool;
+    PoolHandle handle;
+    ~PooledOrder() { pool.destroy(handle); }
+    T& operator*() const { return *pool.get(handle); }
+};
 
 // Forward declarations
 void createStocks();
@@ -24,9 +71,13 @@ double readDouble(const string& prompt);
 
 User* getUserAt(int index);
 Stock* getStockAt(int index);
+OrderBook* getBookFor(const Stock& stock);
 
 // Helper implementations
+// Both readers flush the log first, so messages from the last action are
+// on screen before the prompt
 int readInt(const string& prompt) {
+    Log::flush();
     cout << prompt;
     int value;
     if (!(cin >> value)) {
@@ -39,6 +90,7 @@ int readInt(const string& prompt) {
 
 double readDouble(const string& prompt) {
     // Ask the user for a number
+    Log::flush();
     cout << prompt;
 
     double value;
@@ -60,12 +112,9 @@ double readDouble(const string& prompt) {
 }
 
 User* getUserAt(int index) {
-    if (index < 0 || index >= (int)users.size()) {
-        throw out_of_range("User index out of bounds");
-    }
-    User* u = users[index];
+    User* u = index < 0 ? nullptr : users.find((uint32_t)index);
     if (!u) {
-        throw runtime_error("Null pointer for user");
+        throw out_of_range("User index out of bounds");
     }
     return u;
 }
@@ -81,92 +130,496 @@ Stock* getStockAt(int index) {
     return s;
 }
 
-// File I/O Functions
-void loadStocksFromFile() {
-    ifstream stockFile("data/stocks.txt");
-    if (!stockFile.is_open()) {
-        throw ios_base::failure("Could not open data/stocks.txt");
+OrderBook* getBookFor(const Stock& stock) {
+    if (stock.symbol >= books.size()) {
+        throw out_of_range("No order book for symbol");
     }
-    
-    string line;
-    while (getline(stockFile, line)) {
-        if (!line.empty()) {
-            Stock stock = Stock::loadFromFile(line);
-            stocks.push_back(new Stock(stock));
+    OrderBook* b = books[stock.symbol];
+    if (!b) {
+        throw runtime_error("Null pointer for order book");
+    }
+    return b;
+}
+
+// Also fills stocksBySymbol, so an order's symbol leads to its stock and book directly
+void createBooks() {
+    books.resize(SymbolTable::size(), nullptr);
+    stocksBySymbol.resize(SymbolTable::size(), nullptr);
+    for (size_t i = 0; i < stocks.size(); i++) {
+        stocksBySymbol[stocks[i]->symbol] = stocks[i];
+        if (!books[stocks[i]->symbol]) {
+            books[stocks[i]->symbol] = new OrderBook(stocks[i]->symbol, bookOrdersPerSymbol, bookLevelsPerSymbol);
+            books[stocks[i]->symbol]->setIndex(&openOrders);
         }
     }
-    stockFile.close();
+}
+
+// File I/O Functions
+// Records are parsed straight out of the mapped file and each object is
+// constructed once, in its final heap slot
+void loadStocksFromFile() {
+    MappedFile stockFile("data/stocks.txt");
+    string_view text = stockFile.contents();
+    stocks.reserve(stocks.size() + DelimScanner::countLines(text) + 1);
+    
+    DelimScanner::forEachRecord(text, [](const DelimRecord& record) {
+        stocks.push_back(new Stock(Stock::loadFromRecord(record)));
+    });
     cout << "Loaded " << stocks.size() << " stocks from file.\n";
 }
 
 void loadUsersFromFile() {
-    ifstream userFile("data/users.txt");
-    if (!userFile.is_open()) {
-        throw ios_base::failure("Could not open data/users.txt");
-    }
+    MappedFile userFile("data/users.txt");
+    string_view text = userFile.contents();
+    users.reserve(users.size() + DelimScanner::countLines(text) + 1);
     
-    string line;
-    while (getline(userFile, line)) {
-        if (!line.empty()) {
-            User user = User::loadFromFile(line);
-            users.push_back(new User(user));
-        }
-    }
-    userFile.close();
+    DelimScanner::forEachRecord(text, [](const DelimRecord& record) {
+        users.load(record);
+    });
     cout << "Loaded " << users.size() << " users from file.\n";
 }
 
+// tradeStore files traders by their id in `users`; the history and the
+// journal name them
+uint32_t tradeUserId(string_view name) {
+    UserHandle user = users.handleOf(name);
+    return user.isNone() ? TradeStore::UNKNOWN_USER : user.index;
+}
+
+// Fills tradeStore from the history
 void loadTradesFromFile() {
-    ifstream tradeFile("data/trades.txt");
-    if (!tradeFile.is_open()) {
-        throw ios_base::failure("Could not open data/trades.txt");
-    }
+    MappedFile tradeFile("data/trades.txt");
     
-    string line;
-    int count = 0;
-    while (getline(tradeFile, line)) {
-        if (!line.empty()) count++;
-    }
-    tradeFile.close();
+    size_t malformed = 0;
+    size_t count = tradeStore.loadText(tradeFile.contents(), tradeUserId, malformed);
     cout << "Loaded " << count << " trades from history.\n";
+    if (malformed > 0) {
+        cout << "Skipped " << malformed << " malformed trade line(s).\n";
+    }
 }
 
-void saveUsersToFile() {
-    ofstream userFile("data/users.txt");
-    if (!userFile.is_open()) {
-        throw ios_base::failure("Could not open data/users.txt for writing");
+// Completes the bars whose interval has ended and appends every completed
+// bar not yet saved to data/bars.txt; on exit the open bars go too
+void saveBars(bool exiting = false) {
+    bars.closeExpired(TradeJournal::nowNanos());
+    bars.save("data/bars.txt", exiting);
+}
+
+// Marks every account to the loaded prices and keeps it marked from here on:
+// fills and cash changes come from User, price changes from Stock
+void startValuation() {
+    for (Stock* s : stocks) {
+        valuation.setMark(s->symbol, s->price);
     }
-    for (int i = 0; i < users.size(); i++) {
-        users[i]->saveToFile(userFile);
+    users.forEach([](uint32_t, User& u) {
+        valuation.track(u);
+    });
+    User::setListener(&valuation);
+    Stock::priceListener = &valuation;
+}
+
+// Completed bars of earlier sessions. The bars are built from live trades
+// only: trades.txt has dates, not times.
+void loadBarsFromFile() {
+    size_t malformed = 0;
+    size_t count = bars.load("data/bars.txt", malformed);
+    bars.reserveSymbols(SymbolTable::size());
+    bars.spillTo("data/bars.txt");
+    if (count > 0) {
+        cout << "Loaded " << count << " price bars.\n";
+    }
+    if (malformed > 0) {
+        cout << "Skipped " << malformed << " malformed bar line(s).\n";
+    }
+}
+
+// Rewrites the snapshot in full and empties the change logs
+void saveAllToFiles() {
+    persistence.compact(users, stocks);
+    cout << "Users and stocks saved successfully.\n";
+}
+
+// Appends only the users and stocks changed since the last save, after
+// making sure the trades that caused those changes are on disk
+void saveChanges() {
+    journal.flush();
+    saveBars();
+    size_t written = persistence.flush();
+    if (persistence.needsCompaction(users.size(), stocks.size())) {
+        persistence.compact(users, stocks);
     }
-    userFile.close();
-    cout << "Users saved successfully.\n";
+    cout << written << " changed record(s) saved.\n";
 }
 
-void saveStocksToFile() {
-    ofstream stockFile("data/stocks.txt");
-    if (!stockFile.is_open()) {
-        throw ios_base::failure("Could not open data/stocks.txt for writing");
+// One account's side of a trade. The bars count each execution once, from
+// the incoming order's side. The statistics and bars take the trade even if
+// the journal then cannot.
+void saveTradeToFile(Side side, SymbolId symbol, int qty, Price price, uint32_t userId, bool maker = false) {
+    int64_t now = TradeJournal::nowNanos();
+    tradeStore.append(now, userId, symbol, side, qty, price, maker);
+    if (!maker) {
+        bars.onTrade(now, symbol, qty, price);
     }
-    for (int i = 0; i < stocks.size(); i++) {
-        stocks[i]->saveToFile(stockFile);
+    if (!journal.isOpen()) {
+        journal.open();
     }
-    stockFile.close();
-    cout << "Stocks saved successfully.\n";
+    journal.append(userId, users.find(userId)->getName(), symbol, side, qty, price, maker);
 }
 
-void saveTradeToFile(string type, string symbol, int qty, double price, string user) {
+// Every fill reaches the journal, the statistics and the bars as it happens,
+// the incoming order's side and the resting order's side each as their own
+// trade at the price they traded at. It is called in the middle of matching,
+// where the trade has already happened, so a journal that cannot be written
+// is reported rather than thrown through the book.
+struct TradeRecorder : TradeListener {
+    void onTrade(User& user, Side side, SymbolId symbol, int quantity, Price price, uint64_t, bool maker) override {
+        try {
+            saveTradeToFile(side, symbol, quantity, price, users.idOf(user), maker);
+        } catch (const ios_base::failure& e) {
+            LOG_ERROR("Trade of {} {} for {} not journalled: {}\n", quantity, SymbolTable::name(symbol), user.getName(), e.what());
+        }
+    }
+};
+TradeRecorder tradeRecorder;
+
+// Appends journalled trades to data/trades.txt in the text format and starts a fresh journal
+void exportTradesToFile() {
+    journal.flush();
     ofstream tradeFile("data/trades.txt", ios::app);
     if (!tradeFile.is_open()) {
         throw ios_base::failure("Could not open data/trades.txt for appending");
     }
-    time_t now = time(0);
-    tm* timeinfo = localtime(&now);
-    char buffer[11];
-    strftime(buffer, sizeof(buffer), "%Y-%m-%d", timeinfo);
-    
-    tradeFile << type << "|" << user << "|" << symbol << "|" << qty << "|" << price << "|" << buffer << "\n";
+    size_t count = TradeJournal::exportText("data/journal", tradeFile);
     tradeFile.close();
+    journal.clear();
+    cout << count << " trades exported to data/trades.txt.\n";
+}
+
+// Rebuilds every user's holdings and cash flow from data/trades.txt plus any
+// journal records not yet exported, and checks them against the loaded users
+// and stocks. Returns true if everything matches.
+bool runAudit() {
+    TradeReplay replay;
+    MappedFile tradeFile;   // user names in the replay point into the mapping
+    if (tradeFile.open("data/trades.txt")) {
+        replay.replayText(tradeFile.contents());
+    } else {
+        cout << "No data/trades.txt found; auditing the journal only.\n";
+    }
+    replay.replayJournal("data/journal");
+    AuditReport report = replay.verify(users, stocks);
+    report.display();
+    return report.clean();
+}
+
+// An order read from a --batch file, waiting for its chunk to execute
+struct BatchLine {
+    int32_t entry;          // index into the chunk's OrderBatch, -1 if refused while reading
+    size_t number;          // line number in the order file, from 1
+    const char* problem;    // why it was refused while reading
+};
+
+// One line of a --batch file once it has been checked
+struct BatchOrder {
+    Side side;
+    User* user;
+    SymbolId symbol;
+    int quantity;
+    Price limit;
+};
+
+struct BatchTotals {
+    size_t orders = 0;
+    size_t executed = 0;
+    size_t rejected = 0;
+    int64_t shares = 0;
+    Money notional;
+};
+
+// Reads one order of a --batch file into order. Returns why it cannot be
+// placed, or null if it can.
+const char* parseBatchOrder(const DelimRecord& record, BatchOrder& order) {
+    string_view side = record.count >= 4 ? record.field(0) : string_view();
+    UserHandle user = record.count >= 4 ? users.handleOf(record.field(1)) : UserHandle::none();
+    order.symbol = record.count >= 4 ? SymbolTable::find(record.field(2)) : SymbolTable::INVALID;
+    order.quantity = 0;
+    if (record.count < 4 || (side != "BUY" && side != "SELL")
+        || !parseInt(record.field(3), order.quantity) || !Price::tryParse(record.field(4), order.limit)) {
+        return "malformed order";
+    }
+    if (user.isNone()) {
+        return "unknown user";
+    }
+    if (order.symbol == SymbolTable::INVALID || order.symbol >= stocksBySymbol.size() || !stocksBySymbol[order.symbol]) {
+        return "unknown symbol";
+    }
+    if (order.quantity <= 0 || order.limit <= Price()) {
+        return "quantity and limit must be positive";
+    }
+    order.side = side == "BUY" ? Side::Buy : Side::Sell;
+    order.user = users.get(user);
+    return nullptr;
+}
+
+// Writes the result lines of a batch's orders by order id: a FILL line for
+// every trade, whether the order came in or was resting from an earlier
+// line, and passes the trade on to be recorded as the menu's are. It keeps
+// each order's open quantity until it has none left. A chunk's orders have
+// consecutive ids, so they sit in a vector by id; only orders still open
+// after their chunk, no more than the books hold, need the map.
+struct BatchResults : TradeListener {
+    struct Open {
+        size_t number;      // line in the order file, 0 for no order
+        int left;           // quantity neither traded nor done with
+        Price limit;
+    };
+
+    ofstream& results;
+    BatchTotals& totals;
+    TradeListener* next;
+    uint64_t firstId = 0;                  // id of chunk[0]
+    vector<Open> chunk;                    // by id - firstId
+    unordered_map<uint64_t, Open> resting; // orders of earlier chunks
+
+    BatchResults(ofstream& out, BatchTotals& t, TradeListener* recorder) : results(out), totals(t), next(recorder) {}
+
+    void add(uint64_t id, size_t number, int quantity, Price limit) {
+        if (chunk.empty()) firstId = id;
+        if (id < firstId) return;
+        if (id - firstId >= chunk.size()) chunk.resize(id - firstId + 1, Open{ 0, 0, Price() });
+        chunk[id - firstId] = { number, quantity, limit };
+    }
+
+    // Null if the order is not from the batch
+    Open* find(uint64_t id) {
+        if (id >= firstId && id - firstId < chunk.size()) {
+            return chunk[id - firstId].number != 0 ? &chunk[id - firstId] : nullptr;
+        }
+        auto open = resting.find(id);
+        return open != resting.end() ? &open->second : nullptr;
+    }
+
+    // The rest of the order will not trade: the book had no room for it
+    void expire(uint64_t id) {
+        Open* open = find(id);
+        if (!open || open->left == 0) return;
+        results << open->number << "|EXPIRED|" << open->left << "|" << open->limit << "|\n";
+        open->left = 0;
+    }
+
+    // The order never reached a book
+    void drop(uint64_t id) {
+        Open* open = find(id);
+        if (open) open->left = 0;
+    }
+
+    // Writes RESTING for the chunk's orders still open, in file order, and
+    // keeps them for later chunks
+    void endChunk() {
+        for (auto it = resting.begin(); it != resting.end(); ) {
+            if (it->second.left > 0) ++it;
+            else it = resting.erase(it);
+        }
+        for (size_t i = 0; i < chunk.size(); i++) {
+            const Open& open = chunk[i];
+            if (open.number == 0 || open.left == 0) continue;
+            results << open.number << "|RESTING|" << open.left << "|" << open.limit << "|\n";
+            resting[firstId + i] = open;
+        }
+        chunk.clear();
+    }
+
+    // Writes CANCELLED for every order still open, in file order. Call after
+    // the last endChunk(). Returns how many.
+    size_t cancelOpen() {
+        vector<Open> open;
+        for (const auto& [id, o] : resting) {
+            if (o.left > 0) open.push_back(o);
+        }
+        sort(open.begin(), open.end(), [](const Open& a, const Open& b) { return a.number < b.number; });
+        for (const Open& o : open) {
+            results << o.number << "|CANCELLED|" << o.left << "|" << o.limit << "|\n";
+        }
+        resting.clear();
+        return open.size();
+    }
+
+    void onTrade(User& user, Side side, SymbolId symbol, int quantity, Price price, uint64_t orderId, bool maker) override {
+        Open* open = find(orderId);
+        if (open) {
+            results << open->number << "|FILL|" << quantity << "|" << price << "|\n";
+            open->left -= quantity;
+        }
+        if (!maker) {   // each execution once
+            totals.shares += quantity;
+            totals.notional += price * quantity;
+        }
+        if (next) next->onTrade(user, side, symbol, quantity, price, orderId, maker);
+    }
+};
+
+// Executes one chunk of a batch, its fills written as they happen, then
+// writes REJECTED and EXPIRED lines in file order and RESTING for the rest
+void executeBatchChunk(OrderBatch& batch, vector<BatchLine>& lines, ofstream& results, BatchTotals& totals, BatchResults& open) {
+    batch.execute(stocksBySymbol, books);
+    for (const BatchLine& line : lines) {
+        if (line.entry < 0) {
+            totals.rejected++;
+            results << line.number << "|REJECTED|0|0|" << line.problem << "\n";
+            continue;
+        }
+        BatchEntry& entry = batch[line.entry];
+        const Order& order = OrderBatch::asOrder(entry.order);
+        if (!entry.executed) {
+            totals.rejected++;
+            open.drop(order.getId());
+            RiskReject reason = order.getRejectReason();
+            results << line.number << "|REJECTED|0|0|" << (reason == RiskReject::None ? "no order book" : RiskEngine::describe(reason)) << "\n";
+            continue;
+        }
+        totals.executed++;
+        if (!order.isResting()) {
+            open.expire(order.getId());
+        }
+    }
+    open.endChunk();
+    batch.clear();
+    lines.clear();
+}
+
+// Runs every order in path through the books without prompts. One order per
+// line in the trades.txt layout, SIDE|user|SYMBOL|quantity|limit (anything
+// after the limit, such as a date, is ignored). Results go to resultPath as
+// number|event|quantity|price|reason, number being the order's line: a FILL
+// line per trade, also for orders hit while resting, then the order's
+// outcome if it did not fill at once, and CANCELLED for what still rests at
+// the end. Users, stocks, the journal and bars are saved every
+// batchCommitOrders orders and at the end; orders still resting at the end
+// are cancelled. With shards > 0 the orders go through a ShardedEngine with
+// that many threads instead of the menu's books. Returns false if the order
+// file could not be read.
+bool runBatch(const string& path, const string& resultPath, size_t shards) {
+    MappedFile orderFile;
+    if (!orderFile.open(path)) {
+        cout << "[File error] Could not open " << path << "\n";
+        return false;
+    }
+    ofstream results(resultPath);
+    if (!results.is_open()) {
+        throw ios_base::failure("Could not open " + resultPath + " for writing");
+    }
+
+    // Fills and rejections go to the result file rather than the screen
+    LogLevel level = Log::getLevel();
+    Log::setLevel(LogLevel::Error);
+
+    BatchTotals totals;
+    BatchResults open(results, totals, Order::setTradeListener(nullptr));
+    struct ListenerScope {
+        BatchResults& open;
+        ~ListenerScope() { Order::setTradeListener(open.next); }
+    } scope = { open };
+    Order::setTradeListener(&open);
+    open.chunk.reserve(batchCommitOrders);
+    auto start = chrono::steady_clock::now();
+
+    size_t cancelled = 0;
+    if (shards == 0) {
+        OrderBatch batch;
+        vector<BatchLine> lines;
+        batch.reserve(batchCommitOrders);
+        lines.reserve(batchCommitOrders);
+
+        DelimScanner::forEachRecord(orderFile.contents(), [&](const DelimRecord& record) {
+            BatchLine line = { -1, ++totals.orders, nullptr };
+            BatchOrder order;
+            line.problem = parseBatchOrder(record, order);
+            if (!line.problem) {
+                line.entry = (int32_t)batch.size();
+                if (order.side == Side::Buy) batch.addBuy(order.user, order.symbol, order.quantity, order.limit);
+                else batch.addSell(order.user, order.symbol, order.quantity, order.limit);
+                open.add(OrderBatch::asOrder(batch[line.entry].order).getId(), line.number, order.quantity, order.limit);
+            }
+            lines.push_back(line);
+
+            if (lines.size() >= batchCommitOrders) {
+                executeBatchChunk(batch, lines, results, totals, open);
+                saveChanges();
+            }
+        });
+        executeBatchChunk(batch, lines, results, totals, open);
+
+        // End of the batch: resting orders hand their reservations back
+        cancelled = open.cancelOpen();
+        for (OrderBook* book : books) {
+            if (!book) continue;
+            SymbolId symbol = book->getSymbol();
+            book->cancelAll([&](User* owner, Side side, int quantity, Price price) {
+                if (owner) RiskEngine::release(*owner, side, symbol, quantity, price);
+            });
+        }
+    } else {
+        // The engine has its own books, so the menu's stay as they are.
+        // Stocks are only saved while it is drained.
+        ShardedEngine engine(stocks, shards, bookOrdersPerSymbol, bookLevelsPerSymbol);
+        engine.setOnFill([&](const EngineEvent& e) {
+            open.onTrade(*e.user, e.side, e.symbol, e.quantity, e.price, e.orderId, e.maker);
+        });
+        engine.setOnRelease([&](const EngineEvent& e) { open.expire(e.orderId); });
+        engine.start();
+
+        size_t sinceSave = 0;
+        DelimScanner::forEachRecord(orderFile.contents(), [&](const DelimRecord& record) {
+            size_t number = ++totals.orders;
+            BatchOrder order;
+            const char* problem = parseBatchOrder(record, order);
+            uint64_t id = problem ? 0 : Order::nextId();
+            if (!problem) {
+                open.add(id, number, order.quantity, order.limit);
+                if (engine.submit(*order.user, order.side, order.symbol, order.quantity, order.limit, id)) {
+                    totals.executed++;
+                } else {
+                    // The symbol and quantity were checked above, so the account could not cover it
+                    open.drop(id);
+                    problem = RiskEngine::describe(order.side == Side::Buy ? RiskReject::Cash : RiskReject::Shares);
+                }
+            }
+            if (problem) {
+                totals.rejected++;
+                results << number << "|REJECTED|0|0|" << problem << "\n";
+            }
+
+            if (++sinceSave >= batchCommitOrders) {
+                engine.drain();
+                open.endChunk();
+                saveChanges();
+                sinceSave = 0;
+            }
+        });
+        engine.drain();
+        open.endChunk();
+
+        // End of the batch: stop() hands the resting orders' reservations back
+        cancelled = open.cancelOpen();
+        engine.stop();
+    }
+    saveChanges();
+    results.close();
+    Log::setLevel(level);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Batch: " << totals.orders << " orders in " << seconds << " s ("
+         << (seconds > 0 ? (uint64_t)(totals.orders / seconds) : 0) << " orders/s)";
+    if (shards > 0) {
+        cout << " on " << shards << " shard(s)";
+    }
+    cout << "\n" << totals.executed << " executed, " << totals.rejected << " rejected; "
+         << totals.shares << " shares traded for $" << totals.notional << "\n";
+    if (cancelled > 0) {
+        cout << cancelled << " order(s) still resting at the end were cancelled.\n";
+    }
+    cout << "Results written to " << resultPath << ".\n";
+    return true;
 }
 
 void createStocks() {
@@ -182,25 +635,36 @@ void displayStocks() {
     for (int i = 0; i < stocks.size(); i++) {
         cout << i + 1 << ". ";
         stocks[i]->display();
+        OrderBook* book = stocks[i]->symbol < books.size() ? books[stocks[i]->symbol] : nullptr;
+        if (book && (book->hasBid() || book->hasAsk())) {
+            book->display();
+        }
     }
 }
 
 void createUser() {
     string name;
-    double balance;
+    Money balance;
     
+    Log::flush();
     cout << "\nEnter user name: ";
     cin >> name;
-    balance = readDouble("Enter initial balance: ");
-    if (balance < 0) {
+    balance = Money::fromDouble(readDouble("Enter initial balance: "));
+    if (balance < Money()) {
         throw logic_error("Initial balance cannot be negative");
     }
     
-    users.push_back(new User(name, balance));
+    if (users.find(name)) {
+        throw invalid_argument("A user named " + name + " already exists");
+    }
+    
+    User* newUser = users.get(users.create(name, balance));
+    newUser->markDirty();
+    valuation.track(*newUser);
     cout << "User " << name << " created successfully!\n";
     
     // Save to file immediately
-    saveUsersToFile();
+    saveChanges();
 }
 
 void viewAllUsers() {
@@ -210,9 +674,42 @@ void viewAllUsers() {
     }
     
     cout << "\n--- All Users ---\n";
-    for (int i = 0; i < users.size(); i++) {
-        cout << i + 1 << ". " << users[i]->getName() << " - Balance: " << users[i]->getBalance() << "\n";
+    users.forEach([](uint32_t id, const User& u) {
+        cout << id + 1 << ". " << u.getName() << " - Balance: " << u.getBalance() << "\n";
+    });
+}
+
+// How a menu order trades: its type, time in force and, for a limit
+// order, its limit price
+struct OrderTerms {
+    OrderType type;
+    TimeInForce timeInForce;
+    Price limit;
+};
+
+OrderTerms readOrderTerms(const Stock& stock) {
+    cout << "Order type:\n";
+    cout << "1. Market\n";
+    cout << "2. Market, fill or kill\n";
+    cout << "3. Limit, good till cancelled\n";
+    cout << "4. Limit, immediate or cancel\n";
+    cout << "5. Limit, fill or kill\n";
+    int choice = readInt("Select order type: ");
+    if (choice < 1 || choice > 5) {
+        throw out_of_range("Order type must be between 1 and 5");
+    }
+    static const TimeInForce timeInForce[] = {
+        TimeInForce::IOC, TimeInForce::FOK, TimeInForce::GTC, TimeInForce::IOC, TimeInForce::FOK
+    };
+    OrderTerms terms = { choice <= 2 ? OrderType::Market : OrderType::Limit, timeInForce[choice - 1], stock.price };
+    if (terms.type == OrderType::Limit) {
+        cout << "Current price: $" << stock.price << "\n";
+        terms.limit = Price::fromDouble(readDouble("Enter limit price: "));
+        if (terms.limit <= Price()) {
+            throw logic_error("Limit price must be positive");
+        }
     }
+    return terms;
 }
 
 void buyStocks() {
@@ -234,21 +731,25 @@ void buyStocks() {
         throw logic_error("Quantity to buy must be positive");
     }
     
-    BuyOrder order(currentStock->symbol, quantity, currentStock->price);
+    OrderBook* currentBook = getBookFor(*currentStock);
+    OrderTerms terms = readOrderTerms(*currentStock);
+    PooledOrder<BuyOrder> pooled = { *buyOrders, buyOrders->create(currentStock->symbol, quantity, terms.limit, terms.type, terms.timeInForce) };
+    BuyOrder& order = *pooled;
     
-    if (order.execute(*currentUser, *currentStock)) {
+    bool executed = order.execute(*currentUser, *currentStock, *currentBook);
+    Log::flush();   // the fill messages belong above the summary
+    if (executed && order.wasKilled()) {
+        cout << "Buy order killed: the whole quantity could not fill now. Nothing was traded.\n";
+        order.displayDetails();
+    } else if (executed) {
         cout << "Buy order executed successfully!\n";
         order.displayDetails();
         
-        // Save user and stock data immediately
-        saveUsersToFile();
-        saveStocksToFile();
-        
-        // Log trade to file
-        saveTradeToFile("BUY", currentStock->symbol, quantity, currentStock->price, currentUser->getName());
+        // Save changed user and stock data immediately
+        saveChanges();
         cout << "User data and trade history updated!\n";
     } else {
-        cout << "Buy order failed!\n";
+        cout << "Buy order failed: " << RiskEngine::describe(order.getRejectReason()) << "\n";
     }
 }
 
@@ -271,21 +772,109 @@ void sellStocks() {
         throw logic_error("Quantity to sell must be positive");
     }
     
-    SellOrder order(currentStock->symbol, quantity, currentStock->price);
+    OrderBook* currentBook = getBookFor(*currentStock);
+    OrderTerms terms = readOrderTerms(*currentStock);
+    PooledOrder<SellOrder> pooled = { *sellOrders, sellOrders->create(currentStock->symbol, quantity, terms.limit, terms.type, terms.timeInForce) };
+    SellOrder& order = *pooled;
     
-    if (order.execute(*currentUser, *currentStock)) {
+    bool executed = order.execute(*currentUser, *currentStock, *currentBook);
+    Log::flush();   // the fill messages belong above the summary
+    if (executed && order.wasKilled()) {
+        cout << "Sell order killed: the whole quantity could not fill now. Nothing was traded.\n";
+        order.displayDetails();
+    } else if (executed) {
         cout << "Sell order executed successfully!\n";
         order.displayDetails();
         
-        // Save user and stock data immediately
-        saveUsersToFile();
-        saveStocksToFile();
-        
-        // Log trade to file
-        saveTradeToFile("SELL", currentStock->symbol, quantity, currentStock->price, currentUser->getName());
+        // Save changed user and stock data immediately
+        saveChanges();
         cout << "User data and trade history updated!\n";
     } else {
-        cout << "Sell order failed!\n";
+        cout << "Sell order failed: " << RiskEngine::describe(order.getRejectReason()) << "\n";
+    }
+}
+
+// Open orders by id: cancel one, lower its quantity in place, or replace it
+// with a new quantity and limit. A replacement is a new order with a new id
+// and goes to the back of the queue; it is checked before the old order is
+// cancelled, so a rejected replacement leaves the old order working.
+void manageOrders() {
+    if (openOrders.empty()) {
+        cout << "\nNo open orders.\n";
+        return;
+    }
+    vector<OrderIndex::Entry> open;
+    openOrders.forEach([&](const OrderIndex::Entry& e) { open.push_back(e); });
+    sort(open.begin(), open.end(), [](const OrderIndex::Entry& a, const OrderIndex::Entry& b) { return a.id < b.id; });
+    cout << "\n--- Open Orders ---\n";
+    for (const OrderIndex::Entry& e : open) {
+        const OrderBook::BookOrder* o = e.book->find(e.handle);
+        cout << "#" << e.id << " " << (o->side == Side::Buy ? "BUY " : "SELL ") << o->owner->getName() << " "
+             << SymbolTable::name(e.book->getSymbol()) << " " << o->quantity << " @ " << o->price << "\n";
+    }
+
+    int id = readInt("\nEnter order id: ");
+    const OrderIndex::Entry* entry = openOrders.find(id > 0 ? (uint64_t)id : 0);
+    if (!entry) {
+        throw out_of_range("No open order #" + to_string(id));
+    }
+    const OrderBook::BookOrder order = *entry->book->find(entry->handle);
+    OrderBook* book = entry->book;
+    SymbolId symbol = book->getSymbol();
+    User& owner = *order.owner;
+
+    cout << "1. Cancel\n2. Reduce quantity\n3. Replace (new quantity and limit)\n";
+    int action = readInt("Select action: ");
+    if (action == 1) {
+        openOrders.cancel(id);
+        cout << "Order #" << id << " cancelled.\n";
+    } else if (action == 2) {
+        int quantity = readInt("Enter new quantity (below " + to_string(order.quantity) + "): ");
+        if (!openOrders.reduce(id, quantity)) {
+            throw logic_error("New quantity must be between 0 and " + to_string(order.quantity - 1));
+        }
+        cout << "Order #" << id << (quantity == 0 ? " cancelled.\n" : " reduced to " + to_string(quantity) + ".\n");
+    } else if (action == 3) {
+        int quantity = readInt("Enter new quantity: ");
+        if (quantity <= 0) {
+            throw logic_error("Quantity must be positive");
+        }
+        Price limit = Price::fromDouble(readDouble("Enter new limit price: "));
+        if (limit <= Price()) {
+            throw logic_error("Limit price must be positive");
+        }
+        // What the old order holds back comes free when it is cancelled
+        bool covered = order.side == Side::Buy
+            ? owner.getAvailableCash() + order.price * order.quantity >= limit * quantity
+            : owner.getAvailableShares(symbol) + order.quantity >= quantity;
+        if (!covered) {
+            throw logic_error(string("Replacement rejected: ") +
+                              RiskEngine::describe(order.side == Side::Buy ? RiskReject::Cash : RiskReject::Shares) +
+                              ". Order #" + to_string(id) + " is unchanged");
+        }
+        Stock* stock = symbol < stocksBySymbol.size() ? stocksBySymbol[symbol] : nullptr;
+        if (!stock) {
+            throw runtime_error("No stock for " + SymbolTable::name(symbol) + ". Order #" + to_string(id) + " is unchanged");
+        }
+        openOrders.cancel(id);
+
+        Log::flush();
+        if (order.side == Side::Buy) {
+            PooledOrder<BuyOrder> pooled = { *buyOrders, buyOrders->create(symbol, quantity, limit) };
+            (*pooled).execute(owner, *stock, *book);
+            Log::flush();
+            cout << "Order #" << id << " replaced by:\n";
+            (*pooled).displayDetails();
+        } else {
+            PooledOrder<SellOrder> pooled = { *sellOrders, sellOrders->create(symbol, quantity, limit) };
+            (*pooled).execute(owner, *stock, *book);
+            Log::flush();
+            cout << "Order #" << id << " replaced by:\n";
+            (*pooled).displayDetails();
+        }
+        saveChanges();
+    } else {
+        cout << "Invalid action.\n";
     }
 }
 
@@ -299,6 +888,35 @@ void viewUserPortfolio() {
     int userChoice = readInt("\nSelect user number: ");
     User* currentUser = getUserAt(userChoice - 1);
     currentUser->viewPortfolio();
+
+    // Each position at the stock's current price against what it cost
+    for (const Position& p : currentUser->getPositions()) {
+        const Holding* h = valuation.holding(*currentUser, p.symbol);
+        if (!h) continue;
+        Money value = valuation.mark(p.symbol) * h->quantity;
+        cout << "   " << SymbolTable::name(p.symbol) << ": " << h->quantity << " @ $" << valuation.mark(p.symbol)
+             << " = $" << value << " (cost $" << h->cost << ", P&L $" << value - h->cost << ")\n";
+    }
+    cout << "Market value: $" << valuation.marketValue(*currentUser)
+         << ", unrealized P&L: $" << valuation.unrealized(*currentUser)
+         << ", equity: $" << valuation.equity(*currentUser) << "\n";
+}
+
+// Sets a stock's price; every account holding it is revalued on the spot
+void updateStockPrice() {
+    displayStocks();
+    int stockChoice = readInt("\nSelect stock number: ");
+    Stock* stock = getStockAt(stockChoice - 1);
+
+    Price price = Price::fromDouble(readDouble("Enter new price: "));
+    if (price <= Price()) {
+        throw logic_error("Price must be positive");
+    }
+    stock->updatePrice(price);
+    Log::flush();
+    saveChanges();
+    cout << valuation.holderCount(stock->symbol) << " holder(s) of " << stock->getSymbolName()
+         << " revalued. Book equity: $" << valuation.totalEquity() << "\n";
 }
 
 void addBalance() {
@@ -311,19 +929,129 @@ void addBalance() {
     int userChoice = readInt("\nSelect user number: ");
     User* currentUser = getUserAt(userChoice - 1);
     
-    double amount = readDouble("Enter amount to add: ");
-    if (amount <= 0) {
+    Money amount = Money::fromDouble(readDouble("Enter amount to add: "));
+    if (amount <= Money()) {
         throw logic_error("Amount must be positive");
     }
     
     currentUser->addBalance(amount);
+    Log::flush();
     
     // Save to file immediately
-    saveUsersToFile();
+    saveChanges();
     cout << "Balance added and saved successfully!\n";
 }
 
+// Occupancy of the order pools: objects in use, capacity and high-water mark
+void displayPoolStats() {
+    cout << "Buy order pool: " << buyOrders->size() << "/" << buyOrders->capacity()
+         << " in use (peak " << buyOrders->peak() << ")\n";
+    cout << "Sell order pool: " << sellOrders->size() << "/" << sellOrders->capacity()
+         << " in use (peak " << sellOrders->peak() << ")\n";
+    size_t resting = 0, capacity = 0, peak = 0, levels = 0, levelCapacity = 0;
+    for (OrderBook* book : books) {
+        if (!book) continue;
+        resting += book->orderCount();
+        capacity += book->orderCapacity();
+        peak = max(peak, book->orderPeak());
+        levels += book->levelCount(Side::Buy) + book->levelCount(Side::Sell);
+        levelCapacity += book->levelCapacity();
+    }
+    cout << "Book order pools: " << resting << "/" << capacity
+         << " resting (busiest book peak " << peak << ")\n";
+    cout << "Book price levels: " << levels << "/" << levelCapacity << " in use\n";
+    cout << "Orders rejected by pre-trade checks: " << RiskEngine::rejectedCount(RiskReject::Cash) << " for cash, "
+         << RiskEngine::rejectedCount(RiskReject::Shares) << " for shares\n";
+}
+
+// Per-symbol volume, VWAP, notional and buy/sell imbalance over every
+// recorded execution, plus each stock's volume over the last 24 hours. The
+// store has a row per account; the totals count each execution once, on the
+// side that took liquidity. Also any price bars lost because data/bars.txt
+// could not take them before their ring wrapped.
+void displayTradeStats() {
+    cout << "Trade records: " << tradeStore.size() << ", one per account in a trade ("
+         << TradeStore::implementation() << " kernels)\n";
+    vector<TradeTotals> bySymbol;
+    tradeStore.totalsBySymbol(bySymbol);
+    TimeRange lastDay = { TradeJournal::nowNanos() - 86400LL * 1000000000LL, INT64_MAX };
+    for (SymbolId s = 0; s < bySymbol.size(); s++) {
+        const TradeTotals& t = bySymbol[s];
+        if (t.trades == 0) continue;
+        cout << SymbolTable::name(s) << ": " << t.trades << " trades, volume " << t.volume()
+             << " (buy " << t.buyVolume << " / sell " << t.sellVolume << "), VWAP $" << t.vwap()
+             << ", notional $" << t.notional << ", imbalance " << (int)llround(t.imbalance() * 100) << "%"
+             << ", 24h volume " << tradeStore.totals(s, lastDay).volume() << "\n";
+    }
+    if (bars.droppedCount() > 0) {
+        cout << "Price bars lost before they could be saved: " << bars.droppedCount() << "\n";
+    }
+}
+
+// YYYY-MM-DD HH:MM:SS in UTC
+static string formatBarTime(int64_t ns) {
+    time_t seconds = (time_t)(ns / 1000000000LL);
+    tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char text[32];
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &utc);
+    return text;
+}
+
+static void displayBar(const char* interval, const Bar& bar, bool open) {
+    cout << left << setw(5) << interval << setw(22) << formatBarTime(bar.start) + (open ? " *" : "")
+         << right << setw(12) << bar.open << setw(12) << bar.high << setw(12) << bar.low << setw(12) << bar.close
+         << setw(10) << bar.volume << setw(12) << bar.vwap() << setw(8) << bar.trades << left << "\n";
+}
+
+// The open bar and the most recent completed ones of a stock at every
+// interval, straight from the builder's rings
+void viewPriceBars() {
+    const size_t BARS_SHOWN = 5;
+    displayStocks();
+    int stockChoice = readInt("\nSelect stock number: ");
+    Stock* stock = getStockAt(stockChoice - 1);
+
+    int64_t now = TradeJournal::nowNanos();
+    bars.closeExpired(now);
+    cout << "\n--- " << stock->getSymbolName() << " price bars (UTC, * = still open) ---\n";
+    cout << left << setw(5) << "Bar" << setw(22) << "Start" << right << setw(12) << "Open" << setw(12) << "High"
+         << setw(12) << "Low" << setw(12) << "Close" << setw(10) << "Volume" << setw(12) << "VWAP"
+         << setw(8) << "Trades" << left << "\n";
+    bool any = false;
+    for (size_t k = 0; k < BarBuilder::INTERVAL_COUNT; k++) {
+        const BarBuilder::Interval& interval = BarBuilder::INTERVALS[k];
+        const Bar& open = bars.current(stock->symbol, k);
+        if (!open.empty()) {
+            displayBar(interval.name, open, true);
+            any = true;
+        }
+        // A bar loaded from an earlier run can still be in its interval
+        size_t shown = min(BARS_SHOWN, bars.completedCount(stock->symbol, k));
+        for (size_t age = 0; age < shown; age++) {
+            const Bar& bar = bars.completed(stock->symbol, k, age);
+            displayBar(interval.name, bar, now < bar.start + interval.nanos);
+            any = true;
+        }
+    }
+    if (!any) {
+        cout << "No trades in " << stock->getSymbolName() << " yet.\n";
+    }
+}
+
+// Read from the valuation's running totals, not by walking the accounts
+void displayBookValue() {
+    cout << "Book equity: $" << valuation.totalEquity() << " (cash $" << valuation.totalCash()
+         << ", holdings $" << valuation.totalMarketValue() << ", unrealized P&L $" << valuation.totalUnrealized()
+         << ") across " << valuation.accountCount() << " account(s)\n";
+}
+
 void displayMenu() {
+    Log::flush();
     cout << "\n======== TRADING APPLICATION ========\n";
     cout << "1. Create New User\n";
     cout << "2. View All Users\n";
@@ -334,38 +1062,173 @@ void displayMenu() {
     cout << "7. View Available Stocks\n";
     cout << "8. Add Balance to User\n";
     cout << "9. Exit\n";
+    cout << "10. View Price Bars\n";
+    cout << "11. Update Stock Price\n";
+    cout << "12. Cancel / Amend Order\n";
     cout << "=====================================\n";
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    bool auditOnly = false;
+    bool exportOnly = false;
+    string batchPath;
+    string resultPath;
+    int shards = 0;
+    bool shardsGiven = false;
+    bool badArgs = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--audit") {
+            auditOnly = true;
+        } else if (arg == "--export") {
+            exportOnly = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--results" && i + 1 < argc) {
+            resultPath = argv[++i];
+        } else if (arg == "--shards" && i + 1 < argc) {
+            shardsGiven = true;
+            if (!parseInt(argv[++i], shards) || shards < 0 || shards > 256) badArgs = true;
+        } else {
+            badArgs = true;
+        }
+    }
+    int modes = (int)auditOnly + (int)exportOnly + (int)!batchPath.empty();
+    if (badArgs || modes > 1 || ((!resultPath.empty() || shardsGiven) && batchPath.empty())) {
+        cerr << "Usage: " << argv[0] << " [--audit | --export | --batch ORDERS [--results FILE] [--shards N]]\n";
+        cerr << "  --audit          check users and stocks against the trade history, then exit\n";
+        cerr << "  --export         write data/users.txt and data/stocks.txt from the saved state, then exit\n";
+        cerr << "  --batch ORDERS   execute every order in ORDERS (SIDE|user|SYMBOL|quantity|limit\n";
+        cerr << "                   per line), save, then exit\n";
+        cerr << "  --results FILE   where --batch writes what happens to each order (ORDERS.results)\n";
+        cerr << "  --shards N       run --batch through a sharded engine on N threads, 0 for the\n";
+        cerr << "                   menu's books on this thread (0)\n";
+        return 2;
+    }
+    if (!batchPath.empty() && resultPath.empty()) {
+        resultPath = batchPath + ".results";
+    }
+
+    // Library messages (fills, balance changes) are written by a background thread
+    Log::start();
     cout << "\n=== Welcome to Trading Application ===\n";
     
-    // Load existing data from files
-    cout << "\nLoading data from files...\n";
+    // Pool sizes have to be known before anything is allocated from them
+    size_t orderPoolSize = 1024;
     try {
-        loadStocksFromFile();
-    } catch (const ios_base::failure& e) {
-        cout << "[File error] " << e.what() << ". Using default stocks.\n";
-        createStocks();
+        Config config;
+        if (config.load("data/config.txt")) {
+            long long orderSize = config.getInt("order_pool_size", (long long)orderPoolSize);
+            long long bookSize = config.getInt("book_orders_per_symbol", (long long)bookOrdersPerSymbol);
+            long long levelSize = config.getInt("book_levels_per_symbol", (long long)bookLevelsPerSymbol);
+            if (orderSize < 1 || bookSize < 1 || levelSize < 1 ||
+                orderSize > 0x7FFFFFFF || bookSize > 0x7FFFFFFF || levelSize > 0x7FFFFFFF) {
+                throw invalid_argument("Pool sizes must be between 1 and 2147483647");
+            }
+            orderPoolSize = (size_t)orderSize;
+            bookOrdersPerSymbol = (size_t)bookSize;
+            bookLevelsPerSymbol = (size_t)levelSize;
+
+            long long commitEvery = config.getInt("batch_commit_orders", (long long)batchCommitOrders);
+            if (commitEvery < 1) {
+                cout << "[Config error] batch_commit_orders must be at least 1. Using " << batchCommitOrders << ".\n";
+            } else {
+                batchCommitOrders = (size_t)commitEvery;
+            }
+        }
+    } catch (const invalid_argument& e) {
+        cout << "[Config error] " << e.what() << ". Using default pool sizes.\n";
     }
+    buyOrders = new ObjectPool<BuyOrder>(orderPoolSize);
+    sellOrders = new ObjectPool<SellOrder>(orderPoolSize);
+
+    // Load existing data from files: the snapshot if there is one, else the
+    // text files it was first built from
+    cout << "\nLoading data from files...\n";
+    bool fromSnapshot = false;
     try {
-        loadUsersFromFile();
-    } catch (const ios_base::failure& e) {
-        cout << "[File error] " << e.what() << ". Starting with no users.\n";
+        fromSnapshot = persistence.loadSnapshot(users, stocks);
+        if (fromSnapshot) {
+            cout << "Loaded " << users.size() << " users and " << stocks.size() << " stocks from snapshot.\n";
+        }
+    } catch (const runtime_error& e) {
+        cout << "[File error] " << e.what() << ". Loading the text files instead.\n";
     }
-    try {
-        loadTradesFromFile();
-    } catch (const ios_base::failure& e) {
-        cout << "[File error] " << e.what() << ". No trade history loaded.\n";
+    if (!fromSnapshot) {
+        try {
+            loadStocksFromFile();
+        } catch (const ios_base::failure& e) {
+            cout << "[File error] " << e.what() << ". Using default stocks.\n";
+            createStocks();
+        }
+    }
+    persistence.replayStocks(stocks);
+    createBooks();
+    if (!fromSnapshot) {
+        try {
+            loadUsersFromFile();
+        } catch (const ios_base::failure& e) {
+            cout << "[File error] " << e.what() << ". Starting with no users.\n";
+        }
+    }
+    persistence.replayUsers(users);
+
+    // --audit checks the loaded state against the history and exits without
+    // writing anything: the journal is replayed where it is, not exported.
+    // --export writes the text files and nothing else.
+    // --batch needs neither the valuation nor the history statistics.
+    int exitCode = 0;
+    bool running = !auditOnly && !exportOnly && batchPath.empty();
+    if (auditOnly) {
+        exitCode = runAudit() ? 0 : 1;
+    } else if (exportOnly) {
+        try {
+            persistence.exportText(users, stocks);
+            cout << "Exported " << users.size() << " users to " << persistence.usersPath() << " and "
+                 << stocks.size() << " stocks to " << persistence.stocksPath() << ".\n";
+        } catch (const ios_base::failure& e) {
+            cout << "[File error] " << e.what() << "\n";
+            exitCode = 1;
+        }
+    } else {
+        loadBarsFromFile();
+        if (running) {
+            startValuation();
+            try {
+                loadTradesFromFile();
+            } catch (const ios_base::failure& e) {
+                cout << "[File error] " << e.what() << ". No trade history loaded.\n";
+            }
+        }
+        try {
+            journal.open();
+            // Trades left behind by a session that did not exit cleanly
+            if (journal.recordCount() > 0) {
+                tradeStore.loadJournal("data/journal", tradeUserId);
+                exportTradesToFile();
+            }
+        } catch (const ios_base::failure& e) {
+            cout << "[File error] " << e.what() << ". Trade journal unavailable.\n";
+        }
+        Order::setTradeListener(&tradeRecorder);
+    }
+    if (!batchPath.empty()) {
+        try {
+            exitCode = runBatch(batchPath, resultPath, (size_t)shards) ? 0 : 1;
+            saveBars(true);
+            exportTradesToFile();
+        } catch (const ios_base::failure& e) {
+            cout << "[File error] " << e.what() << "\n";
+            exitCode = 1;
+        }
     }
     
     int choice;
-    bool running = true;
     
     while (running) {
         displayMenu();
         try {
-            choice = readInt("\nEnter your choice (1-9): ");
+            choice = readInt("\nEnter your choice (1-12): ");
 
             switch (choice) {
                 case 1:
@@ -392,6 +1255,9 @@ int main() {
                     cout << "\n--- System Statistics ---\n";
                     User::displayStats();
                     Stock::showTotalStocks();
+                    displayPoolStats();
+                    displayTradeStats();
+                    displayBookValue();
                     break;
                     
                 case 7:
@@ -404,12 +1270,25 @@ int main() {
                     
                 case 9:
                     cout << "\nSaving data to files...\n";
-                    saveUsersToFile();
-                    saveStocksToFile();
+                    saveAllToFiles();
+                    saveBars(true);
+                    exportTradesToFile();
                     cout << "Goodbye!\n";
                     running = false;
                     break;
                     
+                case 10:
+                    viewPriceBars();
+                    break;
+                    
+                case 11:
+                    updateStockPrice();
+                    break;
+
+                case 12:
+                    manageOrders();
+                    break;
+                    
                 default:
                     cout << "Invalid choice. Please try again.\n";
             }
@@ -429,13 +1308,18 @@ int main() {
     }
     
     // Cleanup
-    for (int i = 0; i < users.size(); i++) {
-        delete users[i];
-    }
+    users.clear();
     
     for (int i = 0; i < stocks.size(); i++) {
         delete stocks[i];
     }
     
-    return 0;
+    for (size_t i = 0; i < books.size(); i++) {
+        delete books[i];
+    }
+    delete buyOrders;
+    delete sellOrders;
+    
+    Log::stop();
+    return exitCode;
 }
@@ -0,0 +1,238 @@
+#include "../include/BarBuilder.h"
+#include "../include/DelimScanner.h"
+#include "../include/MappedFile.h"
+#include <fstream>
+#include <stdexcept>
+
+static const int64_t NANOS_PER_SECOND = 1000000000LL;
+
+const BarBuilder::Interval BarBuilder::INTERVALS[BarBuilder::INTERVAL_COUNT] = {
+    { "1s", NANOS_PER_SECOND, 60 },
+    { "1m", 60 * NANOS_PER_SECOND, 60 },
+    { "1h", 3600 * NANOS_PER_SECOND, 48 },
+    { "1d", 86400 * NANOS_PER_SECOND, 30 },
+};
+
+// Start of the interval that contains t (rounding down for times before 1970)
+static int64_t intervalStart(int64_t t, int64_t nanos) {
+    int64_t offset = t % nanos;
+    return offset < 0 ? t - offset - nanos : t - offset;
+}
+
+// parseInt for the 64-bit fields
+static bool parseInt64(string_view text, int64_t& out) {
+    size_t i = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) i = 1;
+    if (i == text.size() || text.size() - i > 18) return false;
+    int64_t value = 0;
+    for (; i < text.size(); i++) {
+        unsigned digit = (unsigned char)text[i] - '0';
+        if (digit > 9) return false;
+        value = value * 10 + digit;
+    }
+    out = negative ? -value : value;
+    return true;
+}
+
+size_t BarBuilder::barsPerSymbol() {
+    size_t total = 0;
+    for (const Interval& interval : INTERVALS) total += interval.keep;
+    return total;
+}
+
+size_t BarBuilder::ringOffset(size_t interval) {
+    size_t offset = 0;
+    for (size_t k = 0; k < interval; k++) offset += INTERVALS[k].keep;
+    return offset;
+}
+
+BarBuilder::BarBuilder(size_t symbols) : symbolCount(0), pending(0), dropped(0) {
+    reserveSymbols(symbols);
+}
+
+void BarBuilder::reserveSymbols(size_t count) {
+    if (count <= symbolCount) return;
+    series.resize(count * INTERVAL_COUNT);
+    history.resize(count * barsPerSymbol());
+    symbolCount = count;
+}
+
+void BarBuilder::complete(SymbolId symbol, size_t interval, const Bar& bar, bool saved) {
+    Series& s = seriesFor(symbol, interval);
+    uint32_t keep = INTERVALS[interval].keep;
+    // The slot about to be overwritten holds the oldest unsaved bar
+    if (s.unsaved == keep && (spillPath.empty() || !spill(symbol, interval, spillPath))) {
+        s.unsaved--;
+        pending--;
+        dropped++;
+    }
+    ring(symbol, interval)[s.next] = bar;
+    s.next = s.next + 1 == keep ? 0 : s.next + 1;
+    if (s.count < keep) s.count++;
+    if (!saved) {
+        s.unsaved++;
+        pending++;
+    }
+}
+
+bool BarBuilder::reopen(SymbolId symbol, size_t interval, int64_t start, Bar& into) {
+    Series& s = seriesFor(symbol, interval);
+    uint32_t keep = INTERVALS[interval].keep;
+    if (s.count == 0) return false;
+    uint32_t newest = s.next == 0 ? keep - 1 : s.next - 1;
+    Bar& bar = ring(symbol, interval)[newest];
+    if (bar.start != start) return false;
+    into = bar;
+    s.next = newest;
+    s.count--;
+    if (s.unsaved > 0) {
+        s.unsaved--;
+        pending--;
+    }
+    return true;
+}
+
+void BarBuilder::onTrade(int64_t timestampNs, SymbolId symbol, int quantity, Price price) {
+    if (symbol >= symbolCount) reserveSymbols(max((size_t)symbol + 1, symbolCount * 2));
+    Money value = price * quantity;
+    for (size_t k = 0; k < INTERVAL_COUNT; k++) {
+        Bar& bar = seriesFor(symbol, k).open;
+        int64_t start = intervalStart(timestampNs, INTERVALS[k].nanos);
+        // A trade stamped before the open bar (clock stepped back) is folded into it
+        if (bar.empty() || start > bar.start) {
+            if (!bar.empty()) complete(symbol, k, bar, false);
+            if (!reopen(symbol, k, start, bar)) {
+                bar.start = start;
+                bar.open = bar.high = bar.low = price;
+                bar.volume = 0;
+                bar.notional = Money();
+                bar.trades = 0;
+            }
+        }
+        if (price > bar.high) bar.high = price;
+        if (price < bar.low) bar.low = price;
+        bar.close = price;
+        bar.volume += quantity;
+        bar.notional += value;
+        bar.trades++;
+    }
+}
+
+void BarBuilder::closeExpired(int64_t nowNs) {
+    for (SymbolId s = 0; s < symbolCount; s++) {
+        for (size_t k = 0; k < INTERVAL_COUNT; k++) {
+            Bar& bar = seriesFor(s, k).open;
+            if (!bar.empty() && nowNs >= bar.start + INTERVALS[k].nanos) {
+                complete(s, k, bar, false);
+                bar = Bar();
+            }
+        }
+    }
+}
+
+const Bar& BarBuilder::current(SymbolId symbol, size_t interval) const {
+    static const Bar none;
+    if (symbol >= symbolCount || interval >= INTERVAL_COUNT) return none;
+    return seriesFor(symbol, interval).open;
+}
+
+size_t BarBuilder::completedCount(SymbolId symbol, size_t interval) const {
+    if (symbol >= symbolCount || interval >= INTERVAL_COUNT) return 0;
+    return seriesFor(symbol, interval).count;
+}
+
+const Bar& BarBuilder::completed(SymbolId symbol, size_t interval, size_t age) const {
+    if (age >= completedCount(symbol, interval)) {
+        throw out_of_range("No completed bar that old");
+    }
+    const Series& s = seriesFor(symbol, interval);
+    uint32_t keep = INTERVALS[interval].keep;
+    return ring(symbol, interval)[(s.next + keep - 1 - age) % keep];
+}
+
+static void writeBar(ofstream& file, const char* interval, SymbolId symbol, const Bar& bar) {
+    file << interval << "|" << SymbolTable::name(symbol) << "|" << bar.start / NANOS_PER_SECOND
+         << "|" << bar.open << "|" << bar.high << "|" << bar.low << "|" << bar.close
+         << "|" << bar.volume << "|" << bar.notional << "|" << bar.trades << "\n";
+}
+
+// The series' unsaved bars, oldest first
+static size_t writeUnsaved(ofstream& file, const char* interval, SymbolId symbol, const Bar* ring, uint32_t keep,
+                           uint32_t next, uint32_t unsaved) {
+    for (uint32_t age = unsaved; age-- > 0; ) {
+        writeBar(file, interval, symbol, ring[(next + keep - 1 - age) % keep]);
+    }
+    return unsaved;
+}
+
+bool BarBuilder::spill(SymbolId symbol, size_t interval, const string& path) {
+    ofstream file(path, ios::app);
+    if (!file.is_open()) return false;
+    Series& s = seriesFor(symbol, interval);
+    writeUnsaved(file, INTERVALS[interval].name, symbol, ring(symbol, interval), INTERVALS[interval].keep, s.next, s.unsaved);
+    pending -= s.unsaved;
+    s.unsaved = 0;
+    return true;
+}
+
+size_t BarBuilder::save(const string& path, bool withOpen) {
+    if (pending == 0 && !withOpen) return 0;
+    ofstream file(path, ios::app);
+    if (!file.is_open()) {
+        throw ios_base::failure("Could not open " + path + " for appending");
+    }
+    size_t written = 0;
+    for (SymbolId s = 0; s < symbolCount; s++) {
+        for (size_t k = 0; k < INTERVAL_COUNT; k++) {
+            Series& series = seriesFor(s, k);
+            written += writeUnsaved(file, INTERVALS[k].name, s, ring(s, k), INTERVALS[k].keep, series.next, series.unsaved);
+            series.unsaved = 0;
+            if (withOpen && !series.open.empty()) {
+                writeBar(file, INTERVALS[k].name, s, series.open);
+                written++;
+            }
+        }
+    }
+    pending = 0;
+    return written;
+}
+
+size_t BarBuilder::load(const string& path, size_t& skipped) {
+    MappedFile file;
+    if (!file.open(path)) return 0;
+    size_t loaded = 0;
+    DelimScanner::forEachRecord(file.contents(), [&](const DelimRecord& record) {
+        Bar bar;
+        int interval = record.count == 9 ? intervalIndex(record.field(0)) : -1;
+        int64_t startSeconds = 0;
+        int trades = 0;
+        bool ok = interval >= 0 && !record.field(1).empty()
+                  && parseInt64(record.field(2), startSeconds)
+                  && Price::tryParse(record.field(3), bar.open) && Price::tryParse(record.field(4), bar.high)
+                  && Price::tryParse(record.field(5), bar.low) && Price::tryParse(record.field(6), bar.close)
+                  && parseInt64(record.field(7), bar.volume) && Money::tryParse(record.field(8), bar.notional)
+                  && parseInt(record.field(9), trades) && trades > 0;
+        if (!ok) {
+            skipped++;
+            return;
+        }
+        bar.start = startSeconds * NANOS_PER_SECOND;
+        bar.trades = (uint32_t)trades;
+        SymbolId symbol = SymbolTable::intern(record.field(1));
+        reserveSymbols(symbol + 1);
+        // A bar saved open and saved again later: the later line wins
+        Bar replaced;
+        reopen(symbol, (size_t)interval, bar.start, replaced);
+        complete(symbol, (size_t)interval, bar, true);
+        loaded++;
+    });
+    return loaded;
+}
+
+int BarBuilder::intervalIndex(string_view name) {
+    for (size_t k = 0; k < INTERVAL_COUNT; k++) {
+        if (name == INTERVALS[k].name) return (int)k;
+    }
+    return -1;
+}
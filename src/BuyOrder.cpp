@@ -1,24 +1,109 @@
 #include "../include/BuyOrder.h"
+#include "../include/Log.h"
 
-BuyOrder::BuyOrder(string sym, int q, double p) : Order(sym, q, p) {
+BuyOrder::BuyOrder(SymbolId sym, int q, Price p, OrderType t, TimeInForce tif) : Order(sym, q, p, t, tif) {
+    buyOrderCount = 0;
+}
+
+BuyOrder::BuyOrder(const string& sym, int q, Price p) : Order(sym, q, p) {
     buyOrderCount = 0;
 }
 
 BuyOrder::~BuyOrder() {
-    cout << "Buy Order deleted\n";
+    LOG_DEBUG("Buy Order deleted\n");
 }
 
 bool BuyOrder::execute(User& user, Stock& stock) {
     if (stock.symbol == symbol && stock.available >= quantity) {
-        user.buyStock(symbol, quantity, price);
+        rejected = RiskEngine::reserve(user, Side::Buy, symbol, quantity, price);
+        if (rejected != RiskReject::None) {
+            LOG_WARN("Buy order rejected: {}\n", RiskEngine::describe(rejected));
+            return false;
+        }
+        user.settleBuy(symbol, quantity, price, price);
         stock.available -= quantity;
+        stock.markDirty();
+        notifyTrade(user, Side::Buy, quantity, price, id);
         buyOrderCount++;
         return true;
     }
     return false;
 }
 
+bool BuyOrder::execute(User& user, Stock& stock, OrderBook& book) {
+    if (stock.symbol != symbol || book.getSymbol() != symbol) {
+        return false;
+    }
+    Price limit = tradeLimit(Side::Buy, stock, book);
+    filledValue = Money();
+    filled = 0;
+
+    // Fill-or-kill is decided before anything is reserved or traded, so a
+    // killed order leaves the book, the stock and the account as they were
+    killed = timeInForce == TimeInForce::FOK && !fillable(Side::Buy, stock, book, limit);
+    if (killed) {
+        LOG_INFO("Fill-or-kill buy of {} {} killed\n", quantity, SymbolTable::name(symbol));
+        buyOrderCount++;
+        return true;
+    }
+
+    // The whole order's cost at the limit is reserved up front; fills pay
+    // out of it and a resting remainder keeps its share
+    rejected = RiskEngine::reserve(user, Side::Buy, symbol, quantity, limit);
+    if (rejected != RiskReject::None) {
+        LOG_WARN("Buy order rejected: {}\n", RiskEngine::describe(rejected));
+        return false;
+    }
+
+    // Resting sellers first, best price and oldest order first, level by level
+    int remaining = book.match(Side::Buy, quantity, limit, [&](const Fill& fill) {
+        user.settleBuy(symbol, fill.quantity, fill.price, limit);
+        notifyTrade(user, Side::Buy, fill.quantity, fill.price, id);
+        if (fill.maker) {
+            fill.maker->settleSell(symbol, fill.quantity, fill.price);
+            notifyTrade(*fill.maker, Side::Sell, fill.quantity, fill.price, fill.makerId, true);
+        }
+        filledValue += fill.price * fill.quantity;
+    });
+
+    // Then the stock's own inventory at its current price
+    int fromStock = remaining > 0 ? fromInventory(Side::Buy, stock, limit, remaining) : 0;
+    if (fromStock > 0) {
+        user.settleBuy(symbol, fromStock, stock.price, limit);
+        stock.available -= fromStock;
+        stock.markDirty();
+        filledValue += stock.price * fromStock;
+        notifyTrade(user, Side::Buy, fromStock, stock.price, id);
+        remaining -= fromStock;
+    }
+
+    if (remaining > 0 && timeInForce == TimeInForce::GTC) {
+        restingHandle = book.rest(Side::Buy, &user, remaining, limit, id);
+        if (restingHandle.isNone()) {
+            LOG_WARN("Order book for {} is full, {} shares not placed\n", SymbolTable::name(symbol), remaining);
+        }
+    }
+    if (remaining > 0 && restingHandle.isNone()) {
+        RiskEngine::release(user, Side::Buy, symbol, remaining, limit);
+    }
+    filled = quantity - remaining;
+    buyOrderCount++;
+    return true;
+}
+
 void BuyOrder::displayDetails() const {
-    cout << "BUY ORDER - Symbol: " << symbol << ", Qty: " << quantity 
-         << ", Price: " << price << "\n";
+    cout << "BUY ORDER #" << id << " (" << describeTerms() << ") - Symbol: " << SymbolTable::name(symbol)
+         << ", Qty: " << quantity;
+    if (type == OrderType::Limit) {
+        cout << ", Price: " << price;
+    }
+    if (killed) {
+        cout << ", Killed: not all of it could fill";
+    } else if (filled != quantity) {
+        cout << ", Filled: " << filled << (isResting() ? ", Resting: " : ", Unfilled: ") << quantity - filled;
+    }
+    if (filled > 0 && type == OrderType::Market) {
+        cout << ", Average: " << getAveragePrice();
+    }
+    cout << "\n";
 }
@@ -0,0 +1,44 @@
+#include "../include/Config.h"
+#include "../include/MappedFile.h"
+#include <stdexcept>
+#include <charconv>
+
+static string_view trim(string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    return text;
+}
+
+bool Config::load(const string& path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    forEachLine(file.contents(), [&](string_view line) {
+        line = trim(line);
+        if (line.empty() || line.front() == '#') return;
+        size_t eq = line.find('=');
+        if (eq == string_view::npos) {
+            throw invalid_argument("Malformed config line: " + string(line));
+        }
+        values[string(trim(line.substr(0, eq)))] = string(trim(line.substr(eq + 1)));
+    });
+    return true;
+}
+
+string Config::getString(const string& key, const string& fallback) const {
+    auto it = values.find(key);
+    return it == values.end() ? fallback : it->second;
+}
+
+long long Config::getInt(const string& key, long long fallback) const {
+    auto it = values.find(key);
+    if (it == values.end()) return fallback;
+    const string& text = it->second;
+    long long value = 0;
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != errc() || result.ptr != text.data() + text.size()) {
+        throw invalid_argument("Config value for " + key + " is not a whole number: " + text);
+    }
+    return value;
+}
@@ -0,0 +1,135 @@
+#include "../include/DelimScanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DELIM_X86 1
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define DELIM_X86 1
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static inline bool isDelim(char c) {
+    return c == '|' || c == ':' || c == ',' || c == '\n';
+}
+
+static size_t scanScalar(const char* data, size_t length, uint32_t* out, size_t from, size_t found) {
+    for (size_t i = from; i < length; i++) {
+        if (isDelim(data[i])) out[found++] = (uint32_t)i;
+    }
+    return found;
+}
+
+static inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+#ifdef DELIM_X86
+
+static size_t scanSse2(const char* data, size_t length, uint32_t* out) {
+    const __m128i pipe = _mm_set1_epi8('|');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t found = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, pipe), _mm_cmpeq_epi8(chunk, colon)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, newline)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(hits);
+        while (mask) {
+            out[found++] = (uint32_t)(i + countTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+    return scanScalar(data, length, out, i, found);
+}
+
+#if defined(__GNUC__)
+#define DELIM_HAVE_AVX2 1
+
+__attribute__((target("avx2")))
+static size_t scanAvx2(const char* data, size_t length, uint32_t* out) {
+    const __m256i pipe = _mm256_set1_epi8('|');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t found = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, pipe), _mm256_cmpeq_epi8(chunk, colon)),
+                                       _mm256_or_si256(_mm256_cmpeq_epi8(chunk, comma), _mm256_cmpeq_epi8(chunk, newline)));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hits);
+        while (mask) {
+            out[found++] = (uint32_t)(i + countTrailingZeros(mask));
+            mask &= mask - 1;
+        }
+    }
+    return scanScalar(data, length, out, i, found);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t countNewlinesAvx2(const char* data, size_t length) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t total = 0;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        total += (size_t)__builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+    }
+    for (; i < length; i++) {
+        if (data[i] == '\n') total++;
+    }
+    return total;
+}
+
+static bool cpuHasAvx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+#endif
+
+size_t DelimScanner::scan(const char* data, size_t length, uint32_t* out) {
+#ifdef DELIM_HAVE_AVX2
+    if (cpuHasAvx2()) return scanAvx2(data, length, out);
+#endif
+#ifdef DELIM_X86
+    return scanSse2(data, length, out);
+#else
+    return scanScalar(data, length, out, 0, 0);
+#endif
+}
+
+size_t DelimScanner::countLines(string_view text) {
+#ifdef DELIM_HAVE_AVX2
+    if (cpuHasAvx2()) return countNewlinesAvx2(text.data(), text.size());
+#endif
+    size_t total = 0;
+    for (char c : text) {
+        total += c == '\n';
+    }
+    return total;
+}
+
+const char* DelimScanner::implementation() {
+#ifdef DELIM_HAVE_AVX2
+    if (cpuHasAvx2()) return "avx2";
+#endif
+#ifdef DELIM_X86
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
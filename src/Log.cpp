@@ -0,0 +1,302 @@
+#include "../include/Log.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <charconv>
+
+atomic<uint8_t> Log::minimumLevel((uint8_t)LogLevel::Debug);
+
+// Single-producer single-consumer byte ring owned by one logging thread.
+// head and tail only ever grow; the producer and consumer sit on separate
+// cache lines so they do not bounce each other's line on every record.
+struct LogRing {
+    static const size_t CAPACITY = 64 * 1024;   // power of two
+    static const uint32_t PADDING = 0x80000000u;
+
+    alignas(64) atomic<uint64_t> head;   // next byte the producer writes
+    uint64_t cachedTail;                 // producer's last view of tail
+    bool owned;                          // a live thread produces into it
+    alignas(64) atomic<uint64_t> tail;   // next byte the consumer reads
+    alignas(64) char data[CAPACITY];
+
+    LogRing() : head(0), cachedTail(0), owned(true), tail(0) {}
+};
+
+// Writer state. Rings are never freed while the process runs. A thread's
+// ring goes back to the pool when the thread exits and the next thread to
+// log takes it over, continuing from its head, so records the old thread
+// left queued are still written in order.
+static const size_t MAX_RINGS = 64;
+
+static LogRing* rings[MAX_RINGS];
+static atomic<size_t> ringCount(0);
+static thread_local LogRing* localRing = nullptr;
+
+static mutex stateMutex;               // guards everything below
+static condition_variable wake;        // writer: new flush request or stop
+static condition_variable flushed;     // flush(): writer caught up
+static ostream* output = &cout;
+static thread writer;
+static atomic<bool> running(false);
+static bool stopRequested = false;
+static uint64_t flushRequests = 0;
+static uint64_t flushesDone = 0;
+static atomic<uint64_t> droppedRecords(0);   // records refused by a full ring
+static uint64_t droppedReported = 0;          // writer only
+
+// Stops the writer thread at exit if the program did not
+struct LogShutdown {
+    ~LogShutdown() { Log::stop(); }
+};
+static LogShutdown logShutdown;
+
+static void writeNow(const char* record) {
+    string text;
+    Log::format(record, text);
+    lock_guard<mutex> lock(stateMutex);
+    output->write(text.data(), (streamsize)text.size());
+}
+
+// Hands the thread's ring back when the thread exits
+struct RingRelease {
+    ~RingRelease() {
+        if (!localRing) return;
+        lock_guard<mutex> lock(stateMutex);
+        localRing->owned = false;
+        localRing = nullptr;
+    }
+};
+
+static LogRing* registerRing() {
+    // Constructed on the thread's first registration only, so its
+    // destructor runs at exit only for threads that took a ring
+    static thread_local RingRelease release;
+    (void)release;
+
+    lock_guard<mutex> lock(stateMutex);
+    size_t count = ringCount.load(memory_order_relaxed);
+    for (size_t r = 0; r < count; r++) {
+        if (!rings[r]->owned) {
+            // The mutex orders the previous owner's last head store before this
+            rings[r]->owned = true;
+            return rings[r];
+        }
+    }
+    if (count == MAX_RINGS) return nullptr;
+    LogRing* ring = new LogRing();
+    rings[count] = ring;
+    ringCount.store(count + 1, memory_order_release);
+    return ring;
+}
+
+void Log::submit(const char* record, size_t size) {
+    if (!running.load(memory_order_acquire)) {
+        writeNow(record);
+        return;
+    }
+    if (!localRing) {
+        localRing = registerRing();
+        if (!localRing) {
+            writeNow(record);   // more logging threads than rings
+            return;
+        }
+    }
+    LogRing& ring = *localRing;
+
+    // A record never wraps: if it does not fit before the end of the buffer,
+    // the rest of the buffer becomes a padding record and it starts at zero
+    uint64_t head = ring.head.load(memory_order_relaxed);
+    size_t offset = (size_t)(head & (LogRing::CAPACITY - 1));
+    size_t padding = LogRing::CAPACITY - offset < size ? LogRing::CAPACITY - offset : 0;
+    size_t needed = padding + size;
+
+    if (head + needed - ring.cachedTail > LogRing::CAPACITY) {
+        ring.cachedTail = ring.tail.load(memory_order_acquire);
+        if (head + needed - ring.cachedTail > LogRing::CAPACITY) {
+            // Full: the writer is behind. Waiting for it would stall the
+            // trading thread on logging, so the record is dropped and counted;
+            // the writer is draining already, as its ring is not empty.
+            droppedRecords.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    if (padding) {
+        uint32_t marker = LogRing::PADDING | (uint32_t)padding;
+        memcpy(ring.data + offset, &marker, sizeof(marker));
+        offset = 0;
+    }
+    memcpy(ring.data + offset, record, size);
+    ring.head.store(head + needed, memory_order_release);
+}
+
+// Formats everything currently queued into text. Returns the records consumed.
+static size_t drain(string& text) {
+    size_t records = 0;
+    size_t count = ringCount.load(memory_order_acquire);
+    for (size_t r = 0; r < count; r++) {
+        LogRing& ring = *rings[r];
+        uint64_t tail = ring.tail.load(memory_order_relaxed);
+        uint64_t head = ring.head.load(memory_order_acquire);
+        while (tail < head) {
+            const char* at = ring.data + (tail & (LogRing::CAPACITY - 1));
+            uint32_t size;
+            memcpy(&size, at, sizeof(size));
+            if (size & LogRing::PADDING) {
+                tail += size & ~LogRing::PADDING;
+                continue;
+            }
+            Log::format(at, text);
+            tail += size;
+            records++;
+        }
+        ring.tail.store(tail, memory_order_release);
+    }
+    return records;
+}
+
+// Notes in the output how many records full rings refused since the last note
+static void reportDropped(string& text) {
+    uint64_t dropped = droppedRecords.load(memory_order_relaxed);
+    if (dropped == droppedReported) return;
+    text += "[log] ";
+    text += to_string(dropped - droppedReported);
+    text += " messages dropped, log ring full\n";
+    droppedReported = dropped;
+}
+
+static void writerLoop() {
+    string text;
+    unique_lock<mutex> lock(stateMutex);
+    while (true) {
+        uint64_t request = flushRequests;
+        bool stopping = stopRequested;
+        lock.unlock();
+
+        text.clear();
+        size_t records = drain(text);
+        reportDropped(text);
+        if (!text.empty()) {
+            output->write(text.data(), (streamsize)text.size());
+        }
+        if (records == 0 || request > flushesDone) {
+            output->flush();
+        }
+
+        lock.lock();
+        if (request > flushesDone) {
+            flushesDone = request;
+            flushed.notify_all();
+        }
+        if (stopping) break;
+        if (records == 0) {
+            // Producers never signal new records, so poll at 1ms when idle
+            wake.wait_for(lock, chrono::milliseconds(1), [] {
+                return stopRequested || flushRequests > flushesDone;
+            });
+        }
+    }
+}
+
+void Log::format(const char* record, string& out) {
+    RecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    const char* arg = record + sizeof(header);
+    uint32_t remaining = header.argCount;
+    const char* f = header.site->format;
+
+    while (*f) {
+        // Copy literal text up to the next placeholder in one append
+        const char* run = f;
+        while (*f && !(f[0] == '{' && f[1] == '}' && remaining > 0)) f++;
+        out.append(run, (size_t)(f - run));
+        if (!*f) break;
+        f += 2;
+        remaining--;
+
+        ArgType type = (ArgType)*arg++;
+        if (type == TEXT) {
+            size_t length = (uint8_t)*arg++;
+            out.append(arg, length);
+            arg += length;
+            continue;
+        }
+        char text[Money::FORMAT_SIZE];
+        char* end = text;
+        int64_t word;
+        memcpy(&word, arg, sizeof(word));
+        arg += sizeof(word);
+        switch (type) {
+            case INT:
+                end = to_chars(text, text + sizeof(text), word).ptr;
+                break;
+            case UINT:
+                end = to_chars(text, text + sizeof(text), (uint64_t)word).ptr;
+                break;
+            case DOUBLE: {
+                double value;
+                memcpy(&value, &word, sizeof(value));
+                end = text + snprintf(text, sizeof(text), "%g", value);
+                break;
+            }
+            case MONEY:
+                end = text + Money::fromUnits(word).format(text);
+                break;
+            default:
+                break;
+        }
+        out.append(text, (size_t)(end - text));
+    }
+}
+
+void Log::start(ostream& out) {
+    lock_guard<mutex> lock(stateMutex);
+    if (running.load(memory_order_relaxed)) return;
+    output->flush();
+    output = &out;
+    stopRequested = false;
+    writer = thread(writerLoop);
+    running.store(true, memory_order_release);
+}
+
+void Log::flush() {
+    unique_lock<mutex> lock(stateMutex);
+    if (!running.load(memory_order_relaxed)) {
+        output->flush();
+        return;
+    }
+    uint64_t ticket = ++flushRequests;
+    wake.notify_one();
+    flushed.wait(lock, [ticket] { return flushesDone >= ticket; });
+}
+
+void Log::stop() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        if (!running.load(memory_order_relaxed)) return;
+        // New messages go straight out from here on; the writer drains the rest
+        running.store(false, memory_order_release);
+        stopRequested = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    // Anything a producer queued between the last drain and the store above
+    string text;
+    drain(text);
+    reportDropped(text);
+    lock_guard<mutex> lock(stateMutex);
+    output->write(text.data(), (streamsize)text.size());
+    output->flush();
+    output = &cout;
+}
+
+uint64_t Log::dropped() {
+    return droppedRecords.load(memory_order_relaxed);
+}
+
+bool Log::isRunning() {
+    return running.load(memory_order_acquire);
+}
@@ -1,31 +1,78 @@
 #include "../include/Order.h"
+#include "../include/Log.h"
 
-Order::Order(string sym, int q, double p) {
+uint64_t Order::lastId = 0;
+TradeListener* Order::tradeListener = nullptr;
+
+Order::Order(SymbolId sym, int q, Price p, OrderType t, TimeInForce tif) {
+    id = nextId();
+    type = t;
+    // Nothing of a market order can rest: there is no price to rest at
+    timeInForce = t == OrderType::Market && tif == TimeInForce::GTC ? TimeInForce::IOC : tif;
+    killed = false;
     symbol = sym;
     quantity = q;
     price = p;
+    filled = 0;
+    filledValue = Money();
+    restingHandle = PoolHandle::none();
+    rejected = RiskReject::None;
+}
+
+Order::Order(const string& sym, int q, Price p) : Order(SymbolTable::intern(sym), q, p) {
 }
 
 Order::~Order() {
-    cout << "Order for " << symbol << " deleted\n";
+    LOG_DEBUG("Order for {} deleted\n", SymbolTable::name(symbol));
+}
+
+Price Order::tradeLimit(Side side, const Stock& stock, const OrderBook& book) const {
+    if (type == OrderType::Limit) return price;
+    // The inventory takes any quantity of a sale at its price, so a market
+    // sell can go as low as it has to
+    if (side == Side::Sell) return Price();
+
+    Price worst;
+    int fromBook = book.crossable(Side::Buy, quantity, Price::max(), &worst);
+    if (fromBook == 0) return stock.price;
+    if (fromBook == quantity) return worst;
+    // The inventory fills what it holds of the rest
+    return fromInventory(Side::Buy, stock, Price::max(), quantity - fromBook) > 0 && stock.price > worst ? stock.price : worst;
+}
+
+bool Order::fillable(Side side, const Stock& stock, const OrderBook& book, Price limit) const {
+    int remaining = quantity - book.crossable(side, quantity, limit);
+    return remaining == 0 || fromInventory(side, stock, limit, remaining) == remaining;
+}
+
+int Order::fromInventory(Side side, const Stock& stock, Price limit, int remaining) const {
+    if (side == Side::Sell) return stock.price >= limit ? remaining : 0;
+    if (stock.price > limit || stock.available <= 0) return 0;
+    if (stock.available >= remaining) return remaining;
+    return timeInForce == TimeInForce::GTC ? 0 : stock.available;
+}
+
+string Order::describeTerms() const {
+    static const char* tifNames[] = { "GTC", "IOC", "FOK" };
+    return string(type == OrderType::Market ? "Market " : "Limit ") + tifNames[(size_t)timeInForce];
 }
 
 void Order::displayDetails() const {
-    cout << "Order - Symbol: " << symbol << ", Qty: " << quantity 
+    cout << "Order #" << id << " - Symbol: " << SymbolTable::name(symbol) << ", Qty: " << quantity 
          << ", Price: " << price << "\n";
 }
 
 bool Order::operator<(Order const& other) const noexcept {
     if (price != other.price) return price < other.price;
-    return symbol < other.symbol;
+    return SymbolTable::name(symbol) < SymbolTable::name(other.symbol);
 }
 
 bool Order::operator==(Order const& other) const noexcept {
-    return symbol == other.symbol && quantity == other.quantity && price == other.price;
+    return id == other.id;
 }
 
 ostream& operator<<(ostream& os, const Order& o) {
-    os << "Order - Symbol: " << o.symbol << ", Qty: " << o.quantity << ", Price: " << o.price;
+    os << "Order #" << o.id << " - Symbol: " << SymbolTable::name(o.symbol) << ", Qty: " << o.quantity << ", Price: " << o.price;
     return os;
 }
 
@@ -0,0 +1,17 @@
+#include "../include/OrderBatch.h"
+
+size_t OrderBatch::execute(const vector<Stock*>& stocksBySymbol, const vector<OrderBook*>& books) {
+    size_t executed = 0;
+    for (BatchEntry& entry : entries) {
+        entry.executed = visit([&](auto& order) {
+            SymbolId symbol = order.getSymbol();
+            if (symbol >= stocksBySymbol.size() || symbol >= books.size()) return false;
+            Stock* stock = stocksBySymbol[symbol];
+            OrderBook* book = books[symbol];
+            if (!stock || !book || !entry.user) return false;
+            return order.execute(*entry.user, *stock, *book);
+        }, entry.order);
+        executed += entry.executed;
+    }
+    return executed;
+}
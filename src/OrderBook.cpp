@@ -0,0 +1,156 @@
+#include "../include/OrderBook.h"
+#include <algorithm>
+
+OrderBook::OrderBook(SymbolId sym, size_t maxOrders, size_t maxLevels) : orders(maxOrders) {
+    symbol = sym;
+    index = nullptr;
+    this->maxLevels = maxLevels < maxOrders ? maxLevels : maxOrders;
+    // Either side can hold every level, and the free list every level too
+    levels.reserve(this->maxLevels);
+    freeLevels.reserve(this->maxLevels);
+    bids.reserve(this->maxLevels);
+    asks.reserve(this->maxLevels);
+}
+
+uint32_t OrderBook::allocLevel(Price price) {
+    uint32_t index;
+    if (!freeLevels.empty()) {
+        index = freeLevels.back();
+        freeLevels.pop_back();
+    } else if (levels.size() == maxLevels) {
+        return NO_ORDER;
+    } else {
+        levels.push_back(PriceLevel());
+        index = (uint32_t)(levels.size() - 1);
+    }
+    PriceLevel& level = levels[index];
+    level.price = price;
+    level.quantity = 0;
+    level.head = NO_ORDER;
+    level.tail = NO_ORDER;
+    level.count = 0;
+    return index;
+}
+
+uint32_t OrderBook::findOrInsertLevel(Side side, Price price) {
+    vector<uint32_t>& ladder = side == Side::Buy ? bids : asks;
+
+    // New orders usually arrive at or near the touch, so check the back first
+    if (!ladder.empty() && levels[ladder.back()].price == price) {
+        return ladder.back();
+    }
+
+    // Ladder is sorted worse-to-better: ascending for bids, descending for asks
+    auto worse = [&](uint32_t levelIndex, Price p) {
+        return side == Side::Buy ? levels[levelIndex].price < p : levels[levelIndex].price > p;
+    };
+    auto pos = lower_bound(ladder.begin(), ladder.end(), price, worse);
+    if (pos != ladder.end() && levels[*pos].price == price) {
+        return *pos;
+    }
+    uint32_t index = allocLevel(price);
+    if (index != NO_ORDER) ladder.insert(pos, index);
+    return index;
+}
+
+void OrderBook::eraseLevel(Side side, uint32_t levelIndex) {
+    vector<uint32_t>& ladder = side == Side::Buy ? bids : asks;
+    if (!ladder.empty() && ladder.back() == levelIndex) {
+        ladder.pop_back();
+    } else {
+        Price price = levels[levelIndex].price;
+        auto worse = [&](uint32_t index, Price p) {
+            return side == Side::Buy ? levels[index].price < p : levels[index].price > p;
+        };
+        auto pos = lower_bound(ladder.begin(), ladder.end(), price, worse);
+        if (pos != ladder.end() && *pos == levelIndex) {
+            ladder.erase(pos);
+        }
+    }
+    freeLevels.push_back(levelIndex);
+}
+
+void OrderBook::unlink(uint32_t index) {
+    BookOrder& order = orders.at(index);
+    PriceLevel& level = levels[order.level];
+
+    if (order.prev != NO_ORDER) orders.at(order.prev).next = order.next;
+    else level.head = order.next;
+    if (order.next != NO_ORDER) orders.at(order.next).prev = order.prev;
+    else level.tail = order.prev;
+
+    level.count--;
+    if (this->index && order.id != 0) this->index->erase(order.id);
+    orders.destroy(orders.handleAt(index));
+}
+
+void OrderBook::remove(uint32_t index) {
+    BookOrder& order = orders.at(index);
+    uint32_t levelIndex = order.level;
+    Side side = order.side;
+    levels[levelIndex].quantity -= order.quantity;
+    unlink(index);
+
+    if (levels[levelIndex].head == NO_ORDER) {
+        eraseLevel(side, levelIndex);
+    }
+}
+
+PoolHandle OrderBook::rest(Side side, User* owner, int quantity, Price price, uint64_t id) {
+    if (orders.full()) {
+        return PoolHandle::none();
+    }
+    uint32_t levelIndex = findOrInsertLevel(side, price);
+    if (levelIndex == NO_ORDER) {
+        return PoolHandle::none();
+    }
+    PriceLevel& level = levels[levelIndex];
+    PoolHandle handle = orders.create(BookOrder{ owner, price, quantity, levelIndex, level.tail, NO_ORDER, side, id });
+
+    if (level.tail != NO_ORDER) orders.at(level.tail).next = handle.index;
+    else level.head = handle.index;
+    level.tail = handle.index;
+    level.count++;
+    level.quantity += quantity;
+    if (index && id != 0) index->insert(id, this, handle);
+    return handle;
+}
+
+bool OrderBook::cancel(PoolHandle handle) {
+    return cancel(handle, [](User*, Side, int, Price) {});
+}
+
+int OrderBook::crossable(Side side, int quantity, Price limit, Price* worst) const {
+    const vector<uint32_t>& ladder = side == Side::Buy ? asks : bids;
+    long long found = 0;
+    for (size_t i = ladder.size(); i > 0 && found < quantity; i--) {
+        const PriceLevel& level = levels[ladder[i - 1]];
+        if (!crosses(side, limit, level.price)) break;
+        found += level.quantity;
+        if (worst) *worst = level.price;
+    }
+    return found < quantity ? (int)found : quantity;
+}
+
+int OrderBook::restingQuantity(PoolHandle handle) const {
+    const BookOrder* order = orders.get(handle);
+    return order ? order->quantity : 0;
+}
+
+void OrderBook::display(int depth) const {
+    cout << "--- Order Book: " << SymbolTable::name(symbol) << " ---\n";
+    // Asks from the furthest shown level down to the best, then bids from the best down
+    size_t first = asks.size() > (size_t)depth ? asks.size() - depth : 0;
+    for (size_t i = first; i < asks.size(); i++) {
+        const PriceLevel& level = levels[asks[i]];
+        cout << "  ASK " << level.price << " x " << level.quantity << " (" << level.count << " orders)\n";
+    }
+    int shown = 0;
+    for (size_t i = bids.size(); i > 0 && shown < depth; i--, shown++) {
+        const PriceLevel& level = levels[bids[i - 1]];
+        cout << "  BID " << level.price << " x " << level.quantity << " (" << level.count << " orders)\n";
+    }
+    if (bids.empty() && asks.empty()) {
+        cout << "  (empty)\n";
+    }
+}
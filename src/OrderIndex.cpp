@@ -0,0 +1,79 @@
+#include "../include/OrderIndex.h"
+#include "../include/OrderBook.h"
+#include "../include/RiskEngine.h"
+
+size_t OrderIndex::findSlot(uint64_t id) const {
+    size_t mask = slots.size() - 1;
+    for (size_t i = home(id); ; i = (i + 1) & mask) {
+        if (slots[i].id == 0 || slots[i].id == id) return i;
+    }
+}
+
+void OrderIndex::rehash(size_t size) {
+    uint32_t bits = 0;
+    while (((size_t)1 << bits) < size) bits++;
+    vector<Entry> old;
+    old.swap(slots);
+    slots.assign((size_t)1 << bits, Entry{ 0, nullptr, PoolHandle::none() });
+    shift = 64 - bits;
+    for (const Entry& e : old) {
+        if (e.id != 0) slots[findSlot(e.id)] = e;
+    }
+}
+
+void OrderIndex::insert(uint64_t id, OrderBook* book, PoolHandle handle) {
+    if ((count + 1) * 4 > slots.size() * 3) {
+        rehash(slots.empty() ? 64 : slots.size() * 2);
+    }
+    Entry& e = slots[findSlot(id)];
+    if (e.id == 0) count++;
+    e = { id, book, handle };
+}
+
+bool OrderIndex::erase(uint64_t id) {
+    if (slots.empty()) return false;
+    size_t mask = slots.size() - 1;
+    size_t hole = findSlot(id);
+    if (slots[hole].id == 0) return false;
+
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole unless that would move them before their home slot
+    slots[hole].id = 0;
+    for (size_t i = (hole + 1) & mask; slots[i].id != 0; i = (i + 1) & mask) {
+        size_t want = home(slots[i].id);
+        if (((i - want) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            slots[i].id = 0;
+            hole = i;
+        }
+    }
+    count--;
+    return true;
+}
+
+const OrderIndex::Entry* OrderIndex::find(uint64_t id) const {
+    if (slots.empty() || id == 0) return nullptr;
+    const Entry& e = slots[findSlot(id)];
+    return e.id == 0 ? nullptr : &e;
+}
+
+bool OrderIndex::cancel(uint64_t id) {
+    const Entry* e = find(id);
+    if (!e) return false;
+    OrderBook* book = e->book;
+    SymbolId symbol = book->getSymbol();
+    // The book erases the entry, so e is not used after this
+    return book->cancel(e->handle, [&](User* owner, Side side, int quantity, Price price) {
+        if (owner) RiskEngine::release(*owner, side, symbol, quantity, price);
+    });
+}
+
+bool OrderIndex::reduce(uint64_t id, int quantity) {
+    const Entry* e = find(id);
+    if (!e) return false;
+    OrderBook* book = e->book;
+    SymbolId symbol = book->getSymbol();
+    return book->reduce(e->handle, quantity, [&](User* owner, Side side, int removed, Price price) {
+        if (owner) RiskEngine::release(*owner, side, symbol, removed, price);
+    });
+}
@@ -0,0 +1,148 @@
+#include "../include/Persistence.h"
+#include "../include/MappedFile.h"
+#include "../include/Snapshot.h"
+#include <unordered_map>
+#include <algorithm>
+#include <cstdio>
+
+Persistence::Persistence(string dir) {
+    dataDir = dir;
+    usersLogLines = 0;
+    stocksLogLines = 0;
+}
+
+void Persistence::openLogs() {
+    if (!usersLog.is_open()) {
+        usersLog.open(usersLogPath(), ios::app);
+        if (!usersLog.is_open()) {
+            throw ios_base::failure("Could not open " + usersLogPath() + " for appending");
+        }
+    }
+    if (!stocksLog.is_open()) {
+        stocksLog.open(stocksLogPath(), ios::app);
+        if (!stocksLog.is_open()) {
+            throw ios_base::failure("Could not open " + stocksLogPath() + " for appending");
+        }
+    }
+}
+
+void Persistence::replayUsers(UserDirectory& users) {
+    MappedFile log;
+    if (!log.open(usersLogPath())) return;
+
+    DelimScanner::forEachRecord(log.contents(), [&](const DelimRecord& record) {
+        usersLogLines++;
+        // Newer record for a known user replaces the loaded one in place
+        users.load(record);
+    });
+}
+
+void Persistence::replayStocks(vector<Stock*>& stocks) {
+    MappedFile log;
+    if (!log.open(stocksLogPath())) return;
+
+    unordered_map<SymbolId, size_t> bySymbol;
+    for (size_t i = 0; i < stocks.size(); i++) {
+        bySymbol[stocks[i]->symbol] = i;
+    }
+
+    DelimScanner::forEachRecord(log.contents(), [&](const DelimRecord& record) {
+        stocksLogLines++;
+        Stock stock = Stock::loadFromRecord(record);
+        auto it = bySymbol.find(stock.symbol);
+        if (it != bySymbol.end()) {
+            *stocks[it->second] = stock;
+        } else {
+            bySymbol[stock.symbol] = stocks.size();
+            stocks.push_back(new Stock(stock));
+        }
+    });
+}
+
+size_t Persistence::flush() {
+    vector<User*>& dirtyUsers = User::getDirtyUsers();
+    vector<Stock*>& dirtyStocks = Stock::dirtyStocks;
+    if (dirtyUsers.empty() && dirtyStocks.empty()) return 0;
+
+    openLogs();
+    for (User* u : dirtyUsers) {
+        u->saveToFile(usersLog);
+    }
+    for (Stock* s : dirtyStocks) {
+        s->saveToFile(stocksLog);
+    }
+    usersLog.flush();
+    stocksLog.flush();
+    if (!usersLog || !stocksLog) {
+        throw ios_base::failure("Could not write change log");
+    }
+
+    size_t written = dirtyUsers.size() + dirtyStocks.size();
+    usersLogLines += dirtyUsers.size();
+    stocksLogLines += dirtyStocks.size();
+    User::clearDirtyUsers();
+    Stock::clearDirtyStocks();
+    return written;
+}
+
+bool Persistence::needsCompaction(size_t userCount, size_t stockCount) const {
+    return usersLogLines > max(userCount, MIN_COMPACT_LINES) ||
+           stocksLogLines > max(stockCount, MIN_COMPACT_LINES);
+}
+
+bool Persistence::loadSnapshot(UserDirectory& users, vector<Stock*>& stocks) {
+    return Snapshot::load(snapshotPath(), users, stocks);
+}
+
+void Persistence::compact(const UserDirectory& users, const vector<Stock*>& stocks) {
+    Snapshot::save(snapshotPath(), users, stocks);
+
+    // The snapshot now holds everything, so the logs can start over
+    usersLog.close();
+    stocksLog.close();
+    usersLog.open(usersLogPath(), ios::trunc);
+    stocksLog.open(stocksLogPath(), ios::trunc);
+    usersLog.close();
+    stocksLog.close();
+    usersLogLines = 0;
+    stocksLogLines = 0;
+    User::clearDirtyUsers();
+    Stock::clearDirtyStocks();
+}
+
+// Writes path through a temporary file renamed into place, so a crash
+// mid-write leaves the previous file whole (as Snapshot::save does)
+template <class Write>
+static void replaceFile(const string& path, Write&& write) {
+    string temp = path + ".tmp";
+    ofstream file(temp, ios::trunc);
+    if (!file.is_open()) {
+        throw ios_base::failure("Could not open " + temp + " for writing");
+    }
+    write(file);
+    file.close();
+    if (!file) {
+        remove(temp.c_str());
+        throw ios_base::failure("Could not write " + temp);
+    }
+#ifdef _WIN32
+    remove(path.c_str());   // rename does not replace an existing file here
+#endif
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        throw ios_base::failure("Could not replace " + path);
+    }
+}
+
+void Persistence::exportText(const UserDirectory& users, const vector<Stock*>& stocks) {
+    replaceFile(usersPath(), [&](ofstream& file) {
+        users.forEach([&](uint32_t, const User& u) {
+            u.saveToFile(file);
+        });
+    });
+    replaceFile(stocksPath(), [&](ofstream& file) {
+        for (size_t i = 0; i < stocks.size(); i++) {
+            stocks[i]->saveToFile(file);
+        }
+    });
+}
@@ -0,0 +1,69 @@
+#include "../include/PositionMap.h"
+
+void PositionMap::rehash(size_t slotCount) {
+    uint32_t bits = 0;
+    while (((size_t)1 << bits) < slotCount) bits++;
+    slots.assign((size_t)1 << bits, Slot{0, EMPTY});
+    shift = 32 - bits;
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        Slot& s = slots[findSlot(positions[i].symbol)];
+        s.symbol = positions[i].symbol;
+        s.index = i;
+    }
+}
+
+void PositionMap::reserve(size_t count) {
+    positions.reserve(count);
+    // Keep the table at most three quarters full
+    size_t wanted = count + count / 3 + 1;
+    if (wanted > slots.size()) {
+        rehash(wanted < 8 ? 8 : wanted);
+    }
+}
+
+Position& PositionMap::findOrInsert(SymbolId symbol) {
+    if ((positions.size() + 1) * 4 > slots.size() * 3) {
+        rehash(slots.empty() ? 8 : slots.size() * 2);
+    }
+    Slot& s = slots[findSlot(symbol)];
+    if (s.index == EMPTY) {
+        s.symbol = symbol;
+        s.index = (uint32_t)positions.size();
+        positions.push_back({symbol, 0, 0});
+    }
+    return positions[s.index];
+}
+
+bool PositionMap::erase(SymbolId symbol) {
+    if (slots.empty()) return false;
+    size_t mask = slots.size() - 1;
+    size_t hole = findSlot(symbol);
+    if (slots[hole].index == EMPTY) return false;
+
+    // Swap-remove from the dense array and repoint the moved position's slot
+    uint32_t index = slots[hole].index;
+    uint32_t last = (uint32_t)positions.size() - 1;
+    if (index != last) {
+        positions[index] = positions[last];
+        slots[findSlot(positions[index].symbol)].index = index;
+    }
+    positions.pop_back();
+
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole unless that would move them before their home slot
+    slots[hole].index = EMPTY;
+    for (size_t i = (hole + 1) & mask; slots[i].index != EMPTY; i = (i + 1) & mask) {
+        size_t want = home(slots[i].symbol);
+        if (((i - want) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            slots[i].index = EMPTY;
+            hole = i;
+        }
+    }
+    return true;
+}
+
+void PositionMap::clear() {
+    positions.clear();
+    for (Slot& s : slots) s.index = EMPTY;
+}
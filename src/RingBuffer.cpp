@@ -0,0 +1,50 @@
+#include "../include/RingBuffer.h"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+WaitStrategy parseWaitStrategy(const string& name) {
+    if (name == "spin") return WaitStrategy::Spin;
+    if (name == "yield") return WaitStrategy::Yield;
+    if (name == "block") return WaitStrategy::Block;
+    throw invalid_argument("Unknown wait strategy '" + name + "' (expected spin, yield or block)");
+}
+
+const char* waitStrategyName(WaitStrategy strategy) {
+    switch (strategy) {
+        case WaitStrategy::Spin: return "spin";
+        case WaitStrategy::Yield: return "yield";
+        default: return "block";
+    }
+}
+
+#ifdef __linux__
+static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+
+// The kernel compares the word with armedState before sleeping, so a
+// notify() that got in after we armed makes this return at once
+void WaitSignal::sleep(uint32_t armedState, chrono::microseconds timeout) {
+    timespec ts;
+    ts.tv_sec = (time_t)(timeout.count() / 1000000);
+    ts.tv_nsec = (long)(timeout.count() % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state), FUTEX_WAIT_PRIVATE, armedState, &ts, nullptr, 0);
+}
+
+void WaitSignal::wakeAll() {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+#else
+// No futex: nap in short slices and let wait() re-check
+void WaitSignal::sleep(uint32_t armedState, chrono::microseconds timeout) {
+    chrono::microseconds slice(50);
+    if (state.load(memory_order_acquire) == armedState) {
+        this_thread::sleep_for(timeout < slice ? timeout : slice);
+    }
+}
+
+void WaitSignal::wakeAll() {}
+#endif
@@ -0,0 +1,13 @@
+#include "../include/RiskEngine.h"
+
+uint64_t RiskEngine::rejections[4] = {};
+
+const char* RiskEngine::describe(RiskReject reason) {
+    switch (reason) {
+        case RiskReject::None: return "accepted";
+        case RiskReject::Quantity: return "quantity must be positive";
+        case RiskReject::Cash: return "insufficient cash";
+        case RiskReject::Shares: return "insufficient shares";
+    }
+    return "unknown";
+}
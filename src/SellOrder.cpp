@@ -1,24 +1,107 @@
 #include "../include/SellOrder.h"
+#include "../include/Log.h"
 
-SellOrder::SellOrder(string sym, int q, double p) : Order(sym, q, p) {
+SellOrder::SellOrder(SymbolId sym, int q, Price p, OrderType t, TimeInForce tif) : Order(sym, q, p, t, tif) {
+    sellOrderCount = 0;
+}
+
+SellOrder::SellOrder(const string& sym, int q, Price p) : Order(sym, q, p) {
     sellOrderCount = 0;
 }
 
 SellOrder::~SellOrder() {
-    cout << "Sell Order deleted\n";
+    LOG_DEBUG("Sell Order deleted\n");
 }
 
 bool SellOrder::execute(User& user, Stock& stock) {
     if (stock.symbol == symbol) {
-        user.sellStock(symbol, quantity, price);
+        rejected = RiskEngine::reserve(user, Side::Sell, symbol, quantity, price);
+        if (rejected != RiskReject::None) {
+            LOG_WARN("Sell order rejected: {}\n", RiskEngine::describe(rejected));
+            return false;
+        }
+        user.settleSell(symbol, quantity, price);
         stock.available += quantity;
+        stock.markDirty();
+        notifyTrade(user, Side::Sell, quantity, price, id);
         sellOrderCount++;
         return true;
     }
     return false;
 }
 
+bool SellOrder::execute(User& user, Stock& stock, OrderBook& book) {
+    if (stock.symbol != symbol || book.getSymbol() != symbol) {
+        return false;
+    }
+    Price limit = tradeLimit(Side::Sell, stock, book);
+    filledValue = Money();
+    filled = 0;
+
+    // Fill-or-kill is decided before anything is reserved or traded, so a
+    // killed order leaves the book, the stock and the account as they were
+    killed = timeInForce == TimeInForce::FOK && !fillable(Side::Sell, stock, book, limit);
+    if (killed) {
+        LOG_INFO("Fill-or-kill sell of {} {} killed\n", quantity, SymbolTable::name(symbol));
+        sellOrderCount++;
+        return true;
+    }
+
+    // Every share offered is reserved up front, so it cannot be sold twice
+    rejected = RiskEngine::reserve(user, Side::Sell, symbol, quantity, limit);
+    if (rejected != RiskReject::None) {
+        LOG_WARN("Sell order rejected: {}\n", RiskEngine::describe(rejected));
+        return false;
+    }
+
+    // Resting buyers first, best price and oldest order first, level by level
+    int remaining = book.match(Side::Sell, quantity, limit, [&](const Fill& fill) {
+        user.settleSell(symbol, fill.quantity, fill.price);
+        notifyTrade(user, Side::Sell, fill.quantity, fill.price, id);
+        if (fill.maker) {
+            fill.maker->settleBuy(symbol, fill.quantity, fill.price, fill.price);
+            notifyTrade(*fill.maker, Side::Buy, fill.quantity, fill.price, fill.makerId, true);
+        }
+        filledValue += fill.price * fill.quantity;
+    });
+
+    // The stock's inventory takes back whatever is left at its current price
+    if (remaining > 0 && fromInventory(Side::Sell, stock, limit, remaining) == remaining) {
+        user.settleSell(symbol, remaining, stock.price);
+        stock.available += remaining;
+        stock.markDirty();
+        filledValue += stock.price * remaining;
+        notifyTrade(user, Side::Sell, remaining, stock.price, id);
+        remaining = 0;
+    }
+
+    if (remaining > 0 && timeInForce == TimeInForce::GTC) {
+        restingHandle = book.rest(Side::Sell, &user, remaining, limit, id);
+        if (restingHandle.isNone()) {
+            LOG_WARN("Order book for {} is full, {} shares not placed\n", SymbolTable::name(symbol), remaining);
+        }
+    }
+    if (remaining > 0 && restingHandle.isNone()) {
+        RiskEngine::release(user, Side::Sell, symbol, remaining, limit);
+    }
+    filled = quantity - remaining;
+    sellOrderCount++;
+    return true;
+}
+
 void SellOrder::displayDetails() const {
-    cout << "SELL ORDER - Symbol: " << symbol << ", Qty: " << quantity 
-         << ", Price: " << price << "\n";
+    cout << "SELL ORDER #" << id << " (" << describeTerms() << ") - Symbol: " << SymbolTable::name(symbol)
+         << ", Qty: " << quantity;
+    if (type == OrderType::Limit) {
+        cout << ", Price: " << price;
+    }
+    if (killed) {
+        cout << ", Killed: not all of it could fill";
+    } else if (filled != quantity) {
+        cout << ", Filled: " << filled << (isResting() ? ", Resting: " : ", Unfilled: ") << quantity - filled;
+    }
+    if (filled > 0 && type == OrderType::Market) {
+        cout << ", Average: " << getAveragePrice();
+    }
+    cout << "\n";
 }
@@ -0,0 +1,217 @@
+#include "../include/ShardedEngine.h"
+#include "../include/RiskEngine.h"
+#include <stdexcept>
+
+ShardedEngine::ShardedEngine(const vector<Stock*>& stocks, size_t shardCount, size_t maxOrdersPerBook,
+                             size_t maxLevelsPerBook, WaitStrategy wait)
+    : events(EVENT_CAPACITY), waitStrategy(wait) {
+    if (shardCount == 0) {
+        throw invalid_argument("Engine needs at least one shard");
+    }
+    stocksBySymbol.assign(SymbolTable::size(), nullptr);
+    books.assign(SymbolTable::size(), nullptr);
+    shardBySymbol.assign(SymbolTable::size(), 0);
+    for (size_t i = 0; i < stocks.size(); i++) {
+        SymbolId symbol = stocks[i]->symbol;
+        if (books[symbol]) continue;
+        stocksBySymbol[symbol] = stocks[i];
+        books[symbol] = new OrderBook(symbol, maxOrdersPerBook, maxLevelsPerBook);
+        shardBySymbol[symbol] = (uint32_t)(i % shardCount);
+    }
+    for (size_t i = 0; i < shardCount; i++) {
+        shards.push_back(make_unique<Shard>());
+    }
+    running = false;
+    rejected = 0;
+    fills = 0;
+}
+
+ShardedEngine::~ShardedEngine() {
+    stop();
+    for (OrderBook* book : books) {
+        delete book;
+    }
+}
+
+void ShardedEngine::start() {
+    if (running) return;
+    for (auto& shard : shards) {
+        Shard* s = shard.get();
+        s->worker = thread([this, s] { shardLoop(*s); });
+    }
+    running = true;
+}
+
+void ShardedEngine::stop() {
+    if (!running) return;
+    drain();
+
+    // The shards are idle and everything they did is visible after drain(),
+    // so the coordinator can empty the books itself
+    for (OrderBook* book : books) {
+        if (!book) continue;
+        SymbolId symbol = book->getSymbol();
+        book->cancelAll([&](User* owner, Side side, int quantity, Price price) {
+            if (owner) RiskEngine::release(*owner, side, symbol, quantity, price);
+        });
+    }
+    for (auto& shard : shards) {
+        shard->inbox.close();
+        shard->worker.join();
+    }
+    running = false;
+}
+
+bool ShardedEngine::submit(User& user, Side side, SymbolId symbol, int quantity, Price limit, uint64_t id) {
+    if (quantity <= 0 || symbol >= books.size() || !books[symbol]) {
+        rejected++;
+        return false;
+    }
+    if (RiskEngine::reserve(user, side, symbol, quantity, limit) != RiskReject::None) {
+        rejected++;
+        return false;
+    }
+
+    Shard& shard = *shards[shardBySymbol[symbol]];
+    shard.staged.push_back({ &user, symbol, side, quantity, limit, id });
+    shard.routed++;
+    if (shard.staged.size() >= ROUTE_BATCH) {
+        publish(shard);
+    }
+    return true;
+}
+
+void ShardedEngine::publish(Shard& shard) {
+    size_t sent = 0;
+    while (sent < shard.staged.size()) {
+        sent += shard.inbox.pushBatch(shard.staged.data() + sent, shard.staged.size() - sent);
+        if (sent < shard.staged.size()) {
+            // The shard may itself be waiting for room in the event ring
+            settleArrived();
+            shard.inbox.waitForSpace(waitStrategy, chrono::microseconds(200));
+        }
+    }
+    shard.staged.clear();
+}
+
+void ShardedEngine::flush() {
+    for (auto& shard : shards) {
+        publish(*shard);
+    }
+}
+
+void ShardedEngine::shardLoop(Shard& shard) {
+    EngineOrder batch[ROUTE_BATCH];
+    vector<EngineEvent> out;
+    while (true) {
+        bool closed = shard.inbox.isClosed();
+        size_t count = shard.inbox.popBatch(batch, ROUTE_BATCH);
+        if (count == 0) {
+            if (closed) return;
+            shard.inbox.waitForItems(waitStrategy, chrono::milliseconds(1));
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            execute(batch[i], out);
+        }
+
+        // Events before the count: drain() reads the count, then the events
+        size_t sent = 0;
+        while (sent < out.size()) {
+            sent += events.pushBatch(out.data() + sent, out.size() - sent);
+            if (sent < out.size()) {
+                progress.notify();   // a draining coordinator should settle now
+                events.waitForSpace(waitStrategy, chrono::milliseconds(1));
+            }
+        }
+        out.clear();
+        shard.processed.fetch_add(count, memory_order_release);
+        progress.notify();
+    }
+}
+
+// Runs on the symbol's shard. Mirrors BuyOrder/SellOrder::execute with the
+// account side replaced by events.
+void ShardedEngine::execute(const EngineOrder& order, vector<EngineEvent>& out) {
+    Stock& stock = *stocksBySymbol[order.symbol];
+    OrderBook& book = *books[order.symbol];
+    Side makerSide = order.side == Side::Buy ? Side::Sell : Side::Buy;
+
+    int remaining = book.match(order.side, order.quantity, order.limit, [&](const Fill& fill) {
+        out.push_back({ EngineEvent::FILL, order.side, false, order.symbol, order.user, fill.quantity, fill.price, order.limit, order.id });
+        if (fill.maker) {
+            // A resting order reserved cash at its own price
+            out.push_back({ EngineEvent::FILL, makerSide, true, order.symbol, fill.maker, fill.quantity, fill.price, fill.price, fill.makerId });
+        }
+    });
+
+    if (remaining > 0) {
+        bool fromInventory = order.side == Side::Buy
+            ? stock.price <= order.limit && stock.available >= remaining
+            : stock.price >= order.limit;
+        if (fromInventory) {
+            stock.available += order.side == Side::Buy ? -remaining : remaining;
+            out.push_back({ EngineEvent::FILL, order.side, false, order.symbol, order.user, remaining, stock.price, order.limit, order.id });
+            remaining = 0;
+        }
+    }
+
+    if (remaining > 0 && book.rest(order.side, order.user, remaining, order.limit, order.id).isNone()) {
+        out.push_back({ EngineEvent::RELEASE, order.side, false, order.symbol, order.user, remaining, Price(), order.limit, order.id });
+    }
+}
+
+void ShardedEngine::settle(const EngineEvent& e) {
+    if (e.type == EngineEvent::FILL) {
+        if (e.side == Side::Buy) {
+            e.user->settleBuy(e.symbol, e.quantity, e.price, e.limit);
+        } else {
+            e.user->settleSell(e.symbol, e.quantity, e.price);
+        }
+        // Only the dirty flag is written here; the shard owns the rest of the Stock
+        stocksBySymbol[e.symbol]->markDirty();
+        fills++;
+        if (onFill) onFill(e);
+    } else {
+        RiskEngine::release(*e.user, e.side, e.symbol, e.quantity, e.limit);
+        if (onRelease) onRelease(e);
+    }
+}
+
+size_t ShardedEngine::settleArrived() {
+    EngineEvent batch[ROUTE_BATCH];
+    size_t total = 0;
+    size_t count;
+    while ((count = events.popBatch(batch, ROUTE_BATCH)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            settle(batch[i]);
+        }
+        total += count;
+    }
+    return total;
+}
+
+size_t ShardedEngine::applyEvents() {
+    flush();
+    return settleArrived();
+}
+
+bool ShardedEngine::idle() const {
+    for (auto& shard : shards) {
+        if (shard->processed.load(memory_order_acquire) != shard->routed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShardedEngine::drain() {
+    flush();
+    while (true) {
+        bool done = idle();
+        // Every event of a processed order was queued before it was counted
+        settleArrived();
+        if (done) return;
+        progress.wait(waitStrategy, chrono::milliseconds(1), [this] { return idle() || !events.empty(); });
+    }
+}
@@ -0,0 +1,207 @@
+#include "../include/Snapshot.h"
+#include "../include/MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+static SnapshotString addString(vector<char>& strings, const string& s) {
+    if (strings.size() + s.size() > UINT32_MAX) {
+        throw ios_base::failure("Snapshot string table is over 4 GiB");
+    }
+    SnapshotString ref = { (uint32_t)strings.size(), (uint32_t)s.size() };
+    strings.insert(strings.end(), s.begin(), s.end());
+    return ref;
+}
+
+size_t Snapshot::save(const string& path, const UserDirectory& users, const vector<Stock*>& stocks) {
+    // Every symbol goes in, so a symbol's index in the file is its SymbolId
+    vector<char> strings;
+    vector<SnapshotString> symbols;
+    symbols.reserve(SymbolTable::size());
+    for (SymbolId s = 0; s < SymbolTable::size(); s++) {
+        symbols.push_back(addString(strings, SymbolTable::name(s)));
+    }
+
+    vector<SnapshotStock> stockRecords;
+    stockRecords.reserve(stocks.size());
+    for (const Stock* s : stocks) {
+        stockRecords.push_back({ s->symbol, s->available, s->price.raw() });
+    }
+
+    vector<SnapshotUser> userRecords;
+    vector<SnapshotPosition> positions;
+    userRecords.reserve(users.size());
+    users.forEach([&](uint32_t, const User& u) {
+        SnapshotUser record;
+        record.name = addString(strings, u.getName());
+        record.balance = u.getBalance().raw();
+        record.firstPosition = (uint32_t)positions.size();
+        record.positionCount = (uint32_t)u.getPositions().size();
+        for (const Position& p : u.getPositions()) {
+            positions.push_back({ p.symbol, p.quantity });
+        }
+        userRecords.push_back(record);
+    });
+    if (positions.size() > UINT32_MAX) {
+        throw ios_base::failure("Snapshot has too many positions");
+    }
+
+    const void* data[SECTION_COUNT] = {
+        strings.data(), symbols.data(), stockRecords.data(), userRecords.data(), positions.data()
+    };
+    size_t bytes[SECTION_COUNT] = {
+        strings.size(),
+        symbols.size() * sizeof(SnapshotString),
+        stockRecords.size() * sizeof(SnapshotStock),
+        userRecords.size() * sizeof(SnapshotUser),
+        positions.size() * sizeof(SnapshotPosition)
+    };
+    uint64_t counts[SECTION_COUNT] = {
+        strings.size(), symbols.size(), stockRecords.size(), userRecords.size(), positions.size()
+    };
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sectionCount = SECTION_COUNT;
+    size_t offset = align8(sizeof(Header));
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        header.sections[i] = { offset, counts[i] };
+        offset = align8(offset + bytes[i]);
+    }
+    header.fileSize = offset;
+
+    string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) {
+        throw ios_base::failure("Could not open " + temp + " for writing");
+    }
+    static const char padding[8] = {};
+    bool ok = fwrite(&header, sizeof(Header), 1, file) == 1;
+    size_t at = sizeof(Header);
+    for (int i = 0; i < SECTION_COUNT && ok; i++) {
+        size_t gap = header.sections[i].offset - at;
+        ok = (gap == 0 || fwrite(padding, 1, gap, file) == gap) &&
+             (bytes[i] == 0 || fwrite(data[i], 1, bytes[i], file) == bytes[i]);
+        at = header.sections[i].offset + bytes[i];
+    }
+    size_t tail = header.fileSize - at;
+    ok = ok && (tail == 0 || fwrite(padding, 1, tail, file) == tail);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        remove(temp.c_str());
+        throw ios_base::failure("Could not write " + temp);
+    }
+
+#ifdef _WIN32
+    remove(path.c_str());   // rename does not replace an existing file here
+#endif
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        throw ios_base::failure("Could not replace " + path);
+    }
+    return header.fileSize;
+}
+
+bool Snapshot::load(const string& path, UserDirectory& users, vector<Stock*>& stocks) {
+    if (!users.empty()) {
+        throw logic_error("A snapshot loads into an empty user directory");
+    }
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    const char* base = file.contents().data();
+    size_t size = file.size();
+    string damaged = path + " is not a valid snapshot";
+
+    Header header;
+    if (size < sizeof(Header)) throw runtime_error(damaged);
+    memcpy(&header, base, sizeof(Header));
+    if (header.magic != MAGIC) throw runtime_error(damaged);
+    if (header.version != VERSION) {
+        throw runtime_error(path + " is snapshot version " + to_string(header.version) +
+                            ", this build reads version " + to_string(VERSION));
+    }
+    if (header.sectionCount != SECTION_COUNT || header.fileSize != size) throw runtime_error(damaged);
+
+    // Sections start 8-byte aligned in a page-aligned mapping, so records
+    // can be read through typed pointers
+    const size_t recordSize[SECTION_COUNT] = {
+        1, sizeof(SnapshotString), sizeof(SnapshotStock), sizeof(SnapshotUser), sizeof(SnapshotPosition)
+    };
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        const SectionEntry& s = header.sections[i];
+        if (s.offset % 8 != 0 || s.offset < sizeof(Header) || s.offset > size ||
+            s.count > (size - s.offset) / recordSize[i]) {
+            throw runtime_error(damaged);
+        }
+    }
+    const char* strings = base + header.sections[STRINGS].offset;
+    uint64_t stringBytes = header.sections[STRINGS].count;
+    const SnapshotString* symbols = (const SnapshotString*)(base + header.sections[SYMBOLS].offset);
+    const SnapshotStock* stockRecords = (const SnapshotStock*)(base + header.sections[STOCKS].offset);
+    const SnapshotUser* userRecords = (const SnapshotUser*)(base + header.sections[USERS].offset);
+    const SnapshotPosition* positions = (const SnapshotPosition*)(base + header.sections[POSITIONS].offset);
+    size_t symbolCount = header.sections[SYMBOLS].count;
+    size_t stockCount = header.sections[STOCKS].count;
+    size_t userCount = header.sections[USERS].count;
+    size_t positionCount = header.sections[POSITIONS].count;
+
+    auto text = [&](const SnapshotString& s) {
+        if (s.offset > stringBytes || s.length > stringBytes - s.offset) throw runtime_error(damaged);
+        return string_view(strings + s.offset, s.length);
+    };
+
+    vector<SymbolId> symbolOf(symbolCount);
+    for (size_t i = 0; i < symbolCount; i++) {
+        symbolOf[i] = SymbolTable::intern(text(symbols[i]));
+    }
+
+    size_t firstStock = stocks.size();
+    auto takeBack = [&] {
+        users.clear();
+        for (size_t i = firstStock; i < stocks.size(); i++) delete stocks[i];
+        stocks.resize(firstStock);
+    };
+    try {
+        stocks.reserve(firstStock + stockCount);
+        for (size_t i = 0; i < stockCount; i++) {
+            const SnapshotStock& r = stockRecords[i];
+            if (r.symbol >= symbolCount) throw runtime_error(damaged);
+            stocks.push_back(new Stock(symbolOf[r.symbol], Price::fromUnits(r.price), r.available));
+        }
+
+        users.reserve(userCount);
+        for (size_t i = 0; i < userCount; i++) {
+            const SnapshotUser& r = userRecords[i];
+            if (r.firstPosition > positionCount || r.positionCount > positionCount - r.firstPosition) {
+                throw runtime_error(damaged);
+            }
+            const SnapshotPosition* held = positions + r.firstPosition;
+            for (uint32_t j = 0; j < r.positionCount; j++) {
+                if (held[j].symbol >= symbolCount) throw runtime_error(damaged);
+            }
+            string_view name = text(r.name);
+            users.emplace([&] {
+                User u(string(name), Money::fromUnits(r.balance));
+                u.positions.reserve(r.positionCount);
+                for (uint32_t j = 0; j < r.positionCount; j++) {
+                    u.positions.findOrInsert(symbolOf[held[j].symbol]).quantity += held[j].quantity;
+                }
+                return u;
+            });
+        }
+    } catch (const invalid_argument&) {
+        // emplace refused a name seen earlier in the file
+        takeBack();
+        throw runtime_error(damaged);
+    } catch (...) {
+        takeBack();
+        throw;
+    }
+    return true;
+}
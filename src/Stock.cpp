@@ -1,54 +1,109 @@
 #include "../include/Stock.h"
-#include <sstream>
+#include "../include/Log.h"
+#include <stdexcept>
 
 int Stock::totalStocks = 0;
+vector<Stock*> Stock::dirtyStocks;
+PriceListener* Stock::priceListener = nullptr;
 
 Stock::Stock() {
-    symbol = "";
-    price = 0.0;
+    symbol = SymbolTable::INVALID;
+    price = Price();
     available = 0;
+    dirty = false;
     totalStocks++;
 }
 
-Stock::Stock(string s, double p, int a) {
+Stock::Stock(SymbolId s, Price p, int a) {
     symbol = s;
     price = p;
     available = a;
+    dirty = false;
     totalStocks++;
 }
 
+Stock::Stock(const string& s, Price p, int a) {
+    symbol = SymbolTable::intern(s);
+    price = p;
+    available = a;
+    dirty = false;
+    totalStocks++;
+}
+
+Stock::Stock(const string& s, double p, int a) : Stock(s, Price::fromDouble(p), a) {
+}
+
+// A stock destroyed with unsaved changes must not stay on the dirty list
+Stock::~Stock() {
+    if (dirty) {
+        for (size_t i = 0; i < dirtyStocks.size(); i++) {
+            if (dirtyStocks[i] == this) {
+                dirtyStocks[i] = dirtyStocks.back();
+                dirtyStocks.pop_back();
+                break;
+            }
+        }
+    }
+}
+
 void Stock::display() const {
-    cout << symbol << " - Price: $" << price << ", Available: " << available << "\n";
+    cout << getSymbolName() << " - Price: $" << price << ", Available: " << available << "\n";
 }
 
-void Stock::updatePrice(double newPrice) {
+void Stock::updatePrice(Price newPrice) {
     price = newPrice;
-    cout << "Updated " << symbol << " price to $" << price << "\n";
+    markDirty();
+    if (priceListener) priceListener->onPriceChange(symbol, price);
+    LOG_INFO("Updated {} price to ${}\n", SymbolTable::name(symbol), price);
 }
 
 void Stock::showTotalStocks() {
     cout << "Total Stock objects created: " << totalStocks << "\n";
 }
 
+void Stock::markDirty() {
+    if (!dirty) {
+        dirty = true;
+        dirtyStocks.push_back(this);
+    }
+}
+
+void Stock::clearDirtyStocks() {
+    for (Stock* s : dirtyStocks) {
+        s->dirty = false;
+    }
+    dirtyStocks.clear();
+}
+
 void Stock::saveToFile(ofstream& file) const {
-    file << symbol << "|" << price << "|" << available << "\n";
+    file << getSymbolName() << "|" << price << "|" << available << "\n";
+}
+
+Stock Stock::loadFromFile(string_view line) {
+    uint32_t delims[64];
+    vector<uint32_t> longLine;
+    uint32_t* index = delims;
+    if (line.size() > 64) {
+        longLine.resize(line.size());
+        index = longLine.data();
+    }
+    DelimRecord record = { line.data(), line.size(), index, DelimScanner::scan(line.data(), line.size(), index) };
+    return loadFromRecord(record);
 }
 
-Stock Stock::loadFromFile(string line) {
-    stringstream ss(line);
-    string symbol, priceStr, availableStr;
-    
-    getline(ss, symbol, '|');
-    getline(ss, priceStr, '|');
-    getline(ss, availableStr);
-    
-    double price = stod(priceStr);
-    int available = stoi(availableStr);
-    
-    return Stock(symbol, price, available);
+Stock Stock::loadFromRecord(const DelimRecord& record) {
+    if (record.count < 2 || record.delimAt(0) != '|' || record.delimAt(1) != '|') {
+        throw invalid_argument("Malformed stock record: " + string(record.line()));
+    }
+    Price price = Price::parse(record.field(1));
+    int available = 0;
+    if (!parseInt(record.field(2), available)) {
+        throw invalid_argument("Invalid available count: " + string(record.field(2)));
+    }
+    return Stock(SymbolTable::intern(record.field(0)), price, available);
 }
 
 ostream& operator<<(ostream& os, const Stock& s) {
-    os << s.symbol << " - Price: $" << s.price << ", Available: " << s.available;
+    os << s.getSymbolName() << " - Price: $" << s.price << ", Available: " << s.available;
     return os;
 }
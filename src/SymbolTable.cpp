@@ -0,0 +1,28 @@
+#include "../include/SymbolTable.h"
+#include <stdexcept>
+
+deque<string> SymbolTable::names;
+unordered_map<string_view, SymbolId> SymbolTable::ids;
+
+SymbolId SymbolTable::intern(string_view symbol) {
+    auto it = ids.find(symbol);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    SymbolId id = (SymbolId)names.size();
+    names.emplace_back(symbol);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+SymbolId SymbolTable::find(string_view symbol) {
+    auto it = ids.find(symbol);
+    return it == ids.end() ? INVALID : it->second;
+}
+
+const string& SymbolTable::name(SymbolId id) {
+    if (id >= names.size()) {
+        throw out_of_range("Unknown symbol id");
+    }
+    return names[id];
+}
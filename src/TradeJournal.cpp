@@ -0,0 +1,387 @@
+#include "../include/TradeJournal.h"
+#include "../include/MappedFile.h"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+namespace fs = std::filesystem;
+
+// Segment numbers of trades-NNNNNN.bin files in a directory, ascending
+static vector<uint32_t> listSegments(const string& dir) {
+    vector<uint32_t> numbers;
+    error_code ec;
+    if (!fs::is_directory(dir, ec)) return numbers;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (name.size() == 17 && name.compare(0, 7, "trades-") == 0 && name.compare(13, 4, ".bin") == 0) {
+            numbers.push_back((uint32_t)stoul(name.substr(7, 6)));
+        }
+    }
+    sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+static const size_t SLOT = sizeof(TradeRecord);
+
+// Walks the record slots of a segment body, calling onName(kind, id, name)
+// for each name and onTrade(record) for each trade. Returns the bytes taken
+// by whole records: a crash can leave a torn record or a name missing some
+// of its slots at the end, and that ends the walk.
+template <class OnName, class OnTrade>
+static size_t scanRecords(string_view body, const string& path, OnName&& onName, OnTrade&& onTrade) {
+    size_t at = 0;
+    while (body.size() - at >= SLOT) {
+        const char* slot = body.data() + at;
+        JournalKind kind = (JournalKind)slot[offsetof(TradeRecord, kind)];
+        if (kind == JournalKind::Trade) {
+            TradeRecord record;
+            memcpy(&record, slot, SLOT);
+            onTrade(record);
+            at += SLOT;
+        } else if (kind == JournalKind::UserName || kind == JournalKind::SymbolName) {
+            NameRecord name;
+            memcpy(&name, slot, SLOT);
+            size_t slots = 1 + (name.length + SLOT - 1) / SLOT;
+            if (slots > (body.size() - at) / SLOT) break;
+            onName(kind, name.id, string_view(slot + SLOT, name.length));
+            at += slots * SLOT;
+        } else {
+            throw runtime_error("Damaged trade journal segment " + path);
+        }
+    }
+    return at;
+}
+
+TradeJournal::TradeJournal(string dir, size_t maxSegmentBytes, size_t bufferBytes) {
+    directory = dir;
+    segmentBytes = maxSegmentBytes;
+    buffer.resize(max(bufferBytes, sizeof(TradeRecord)));
+    buffered = 0;
+    segment = nullptr;
+    segmentNumber = 0;
+    segmentSize = 0;
+    nextSequence = 1;
+}
+
+TradeJournal::~TradeJournal() {
+    try {
+        close();
+    } catch (...) {
+        // Nothing sensible to do with a failed final write during shutdown
+    }
+}
+
+string TradeJournal::segmentPath(uint32_t number) const {
+    char name[32];
+    snprintf(name, sizeof(name), "trades-%06u.bin", number);
+    return directory + "/" + name;
+}
+
+void TradeJournal::openSegment(uint32_t number) {
+    string path = segmentPath(number);
+    error_code ec;
+    uintmax_t existing = fs::exists(path, ec) ? fs::file_size(path, ec) : 0;
+
+    segment = fopen(path.c_str(), "ab");
+    if (!segment) {
+        throw ios_base::failure("Could not open " + path + " for appending");
+    }
+    segmentNumber = number;
+    segmentSize = (size_t)existing;
+
+    if (existing == 0) {
+        SegmentHeader header = { MAGIC, VERSION, (uint32_t)sizeof(TradeRecord), 0 };
+        memcpy(buffer.data() + buffered, &header, sizeof(header));
+        buffered += sizeof(header);
+        segmentSize += sizeof(header);
+    }
+}
+
+void TradeJournal::open() {
+    if (segment) return;
+    fs::create_directories(directory);
+
+    forgetNames();
+    nextSequence = 1;
+    vector<uint32_t> segments = listSegments(directory);
+    if (segments.empty()) {
+        openSegment(1);
+        return;
+    }
+
+    // Resume from the newest segment, dropping a torn record left by a crash
+    uint32_t last = segments.back();
+    string path = segmentPath(last);
+    uintmax_t size = fs::file_size(path);
+    if (size < sizeof(SegmentHeader)) {
+        fs::resize_file(path, 0);
+    } else {
+        size_t whole;
+        {
+            MappedFile file(path);
+            string_view body = file.contents().substr(sizeof(SegmentHeader));
+            whole = scanRecords(body, path, [](JournalKind, uint32_t, string_view) {}, [](const TradeRecord&) {});
+        }
+        fs::resize_file(path, sizeof(SegmentHeader) + whole);
+    }
+
+    // The names already defined keep their ids; new ones continue after them
+    forEachTrade(directory, [&](const JournalTrade& t) {
+        nextSequence = t.sequence + 1;
+    }, [&](JournalKind kind, uint32_t id, string_view name) {
+        if (kind == JournalKind::UserName) {
+            if (id >= userNames.size()) userNames.resize(id + 1);
+            userNames[id] = string(name);
+            userIds[string(name)] = id;
+        } else {
+            symbolIds[string(name)] = id;
+        }
+    });
+    openSegment(last);
+}
+
+void TradeJournal::writeBuffer() {
+    if (buffered == 0) return;
+    if (fwrite(buffer.data(), 1, buffered, segment) != buffered) {
+        throw ios_base::failure("Could not write trade journal segment");
+    }
+    buffered = 0;
+}
+
+void TradeJournal::reserveSpace(size_t bytes) {
+    if (segmentSize + bytes > segmentBytes && segmentSize > sizeof(SegmentHeader)) {
+        writeBuffer();
+        fclose(segment);
+        segment = nullptr;
+        openSegment(segmentNumber + 1);
+    }
+}
+
+void TradeJournal::put(const void* data, size_t bytes) {
+    const char* from = (const char*)data;
+    segmentSize += bytes;
+    while (bytes > 0) {
+        if (buffered == buffer.size()) writeBuffer();
+        size_t part = min(bytes, buffer.size() - buffered);
+        memcpy(buffer.data() + buffered, from, part);
+        buffered += part;
+        from += part;
+        bytes -= part;
+    }
+}
+
+// Writes a name's record and slots; a name never spans two segments
+uint32_t TradeJournal::defineName(JournalKind kind, const string& name, uint32_t id) {
+    static const char padding[SLOT] = {};
+    NameRecord record;
+    memset(&record, 0, sizeof(record));
+    record.id = id;
+    record.length = (uint32_t)name.size();
+    record.kind = kind;
+    size_t slots = (name.size() + SLOT - 1) / SLOT;
+    reserveSpace((1 + slots) * SLOT);
+    put(&record, SLOT);
+    put(name.data(), name.size());
+    put(padding, slots * SLOT - name.size());
+    return id;
+}
+
+uint32_t TradeJournal::journalUser(uint32_t userId, const string& name) {
+    if (userId >= userCache.size()) {
+        userCache.resize((size_t)userId + 1, NO_ID);
+    }
+    uint32_t& cached = userCache[userId];
+    if (cached != NO_ID && userNames[cached] == name) return cached;
+
+    auto known = userIds.find(name);
+    if (known != userIds.end()) {
+        cached = known->second;
+    } else {
+        cached = defineName(JournalKind::UserName, name, (uint32_t)userNames.size());
+        userNames.push_back(name);
+        userIds.emplace(name, cached);
+    }
+    return cached;
+}
+
+uint32_t TradeJournal::journalSymbol(SymbolId symbol) {
+    if (symbol >= symbolCache.size()) {
+        symbolCache.resize((size_t)symbol + 1, NO_ID);
+    }
+    uint32_t& cached = symbolCache[symbol];
+    if (cached != NO_ID) return cached;
+
+    const string& name = SymbolTable::name(symbol);
+    auto known = symbolIds.find(name);
+    if (known != symbolIds.end()) {
+        cached = known->second;
+    } else {
+        cached = defineName(JournalKind::SymbolName, name, (uint32_t)symbolIds.size());
+        symbolIds.emplace(name, cached);
+    }
+    return cached;
+}
+
+void TradeJournal::forgetNames() {
+    userNames.clear();
+    userIds.clear();
+    symbolIds.clear();
+    userCache.clear();
+    symbolCache.clear();
+}
+
+uint64_t TradeJournal::append(uint32_t userId, const string& userName, SymbolId symbol, Side side, int quantity, Price price,
+                              bool maker) {
+    if (!segment) {
+        throw runtime_error("Trade journal is not open");
+    }
+    // Names first: a trade is read back after the names it uses
+    uint32_t user = journalUser(userId, userName);
+    uint32_t stock = journalSymbol(symbol);
+    reserveSpace(SLOT);
+
+    TradeRecord record;
+    record.sequence = nextSequence++;
+    record.timestampNs = nowNanos();
+    record.userId = user;
+    record.symbol = stock;
+    record.quantity = quantity;
+    record.side = side == Side::Buy ? 0 : 1;
+    record.kind = JournalKind::Trade;
+    record.maker = maker ? 1 : 0;
+    record.reserved = 0;
+    record.price = price.raw();
+
+    put(&record, sizeof(record));
+    return record.sequence;
+}
+
+void TradeJournal::flush() {
+    if (!segment) return;
+    writeBuffer();
+    fflush(segment);
+}
+
+void TradeJournal::close() {
+    if (!segment) return;
+    flush();
+    fclose(segment);
+    segment = nullptr;
+}
+
+void TradeJournal::clear() {
+    bool wasOpen = segment != nullptr;
+    if (wasOpen) {
+        buffered = 0;
+        fclose(segment);
+        segment = nullptr;
+    }
+    for (uint32_t number : listSegments(directory)) {
+        fs::remove(segmentPath(number));
+    }
+    forgetNames();
+    nextSequence = 1;
+    if (wasOpen) {
+        openSegment(1);
+    }
+}
+
+size_t TradeJournal::forEachTrade(const string& dir, const function<void(const JournalTrade&)>& visit) {
+    return forEachTrade(dir, visit, [](JournalKind, uint32_t, string_view) {});
+}
+
+size_t TradeJournal::forEachTrade(const string& dir, const function<void(const JournalTrade&)>& visit,
+                                  const function<void(JournalKind, uint32_t, string_view)>& onName) {
+    size_t count = 0;
+    // Names by journal id; they hold for every later segment too
+    vector<string> users;
+    vector<SymbolId> symbols;
+
+    for (uint32_t number : listSegments(dir)) {
+        char name[32];
+        snprintf(name, sizeof(name), "trades-%06u.bin", number);
+        string path = dir + "/" + name;
+
+        MappedFile file(path);
+        string_view contents = file.contents();
+        if (contents.size() < sizeof(SegmentHeader)) continue;   // empty segment
+        SegmentHeader header;
+        memcpy(&header, contents.data(), sizeof(header));
+        if (header.magic != MAGIC || header.recordSize != SLOT) {
+            throw runtime_error("Unrecognised trade journal segment " + path);
+        }
+        if (header.version != VERSION) {
+            throw runtime_error(path + " is trade journal version " + to_string(header.version) +
+                                ", this build reads version " + to_string(VERSION));
+        }
+
+        auto defined = [&](JournalKind kind, uint32_t id, string_view text) {
+            if (kind == JournalKind::UserName) {
+                if (id >= users.size()) users.resize((size_t)id + 1);
+                users[id] = string(text);
+            } else {
+                if (id >= symbols.size()) symbols.resize((size_t)id + 1, (SymbolId)SymbolTable::INVALID);
+                symbols[id] = SymbolTable::intern(text);
+            }
+            onName(kind, id, text);
+        };
+        auto trade = [&](const TradeRecord& r) {
+            if (r.userId >= users.size() || users[r.userId].empty() ||
+                r.symbol >= symbols.size() || symbols[r.symbol] == SymbolTable::INVALID) {
+                throw runtime_error("Trade journal segment " + path + " uses a name it never defined");
+            }
+            JournalTrade t = { r.sequence, r.timestampNs, r.userId, users[r.userId], symbols[r.symbol],
+                               r.side == 0 ? Side::Buy : Side::Sell, r.quantity, Price::fromUnits(r.price), r.maker != 0 };
+            visit(t);
+            count++;
+        };
+        scanRecords(contents.substr(sizeof(SegmentHeader)), path, defined, trade);
+    }
+    return count;
+}
+
+size_t TradeJournal::exportText(const string& dir, ostream& out) {
+    // localtime/strftime only run when a record falls on a new day
+    int64_t dayStart = 1, dayEnd = 0;
+    char date[11] = "";
+
+    return forEachTrade(dir, [&](const JournalTrade& t) {
+        int64_t seconds = t.timestampNs / 1000000000;
+        if (seconds < dayStart || seconds >= dayEnd) {
+            time_t tt = (time_t)seconds;
+            tm local = *localtime(&tt);
+            strftime(date, sizeof(date), "%Y-%m-%d", &local);
+            dayStart = seconds - (local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec);
+            dayEnd = dayStart + 86400;
+        }
+        out << (t.side == Side::Buy ? "BUY" : "SELL") << "|" << t.user << "|"
+            << SymbolTable::name(t.symbol) << "|" << t.quantity << "|"
+            << t.price << "|" << date << (t.maker ? "|MAKER\n" : "\n");
+    });
+}
+
+bool TradeJournal::parseText(const DelimRecord& record, TradeText& out, SymbolId (*resolve)(string_view)) {
+    if (record.count != 5 && record.count != 6) return false;
+    for (size_t i = 0; i < record.count; i++) {
+        if (record.delimAt(i) != '|') return false;
+    }
+    out.maker = record.count == 6;
+    if (out.maker && record.field(6) != "MAKER") return false;
+    string_view type = record.field(0);
+    if (type == "BUY") out.side = Side::Buy;
+    else if (type == "SELL") out.side = Side::Sell;
+    else return false;
+
+    out.user = record.field(1);
+    if (!parseInt(record.field(3), out.quantity)) return false;
+    if (!Price::tryParse(record.field(4), out.price)) return false;
+    out.symbol = resolve(record.field(2));
+    out.date = record.field(5);
+    return true;
+}
+
+int64_t TradeJournal::nowNanos() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
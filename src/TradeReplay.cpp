@@ -0,0 +1,295 @@
+#include "../include/TradeReplay.h"
+#include "../include/TradeJournal.h"
+#include "../include/DelimScanner.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// Everything one thread got out of its chunk of trades.txt
+struct ChunkTotals {
+    vector<unordered_map<string_view, ReplayedUser>> partitions;
+    vector<int64_t> netBought;
+    size_t trades = 0;
+    size_t malformed = 0;
+    size_t unknownSymbols = 0;
+};
+
+// Runs work(0) .. work(count - 1), each on its own thread, the last one on
+// the calling thread
+template <class Work>
+static void runParallel(size_t count, Work&& work) {
+    vector<thread> workers;
+    for (size_t i = 0; i + 1 < count; i++) {
+        workers.emplace_back([&work, i] { work(i); });
+    }
+    if (count > 0) work(count - 1);
+    for (thread& t : workers) {
+        t.join();
+    }
+}
+
+static void addTrade(unordered_map<string_view, ReplayedUser>& users, vector<int64_t>& netBought,
+                     string_view user, SymbolId symbol, Side side, int quantity, Price price) {
+    ReplayedUser& totals = users[user];
+    int shares = side == Side::Buy ? quantity : -quantity;
+    totals.positions.findOrInsert(symbol).quantity += shares;
+    if (side == Side::Buy) totals.cashFlow -= price * quantity;
+    else totals.cashFlow += price * quantity;
+    totals.trades++;
+    netBought[symbol] += shares;
+}
+
+static void mergeInto(ReplayedUser& into, const ReplayedUser& from) {
+    into.cashFlow += from.cashFlow;
+    into.trades += from.trades;
+    into.positions.reserve(into.positions.size() + from.positions.size());
+    for (const Position& p : from.positions) {
+        into.positions.findOrInsert(p.symbol).quantity += p.quantity;
+    }
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+TradeReplay::TradeReplay(unsigned threads) {
+    threadCount = threads ? threads : thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 1;
+    partitions.resize(threadCount);
+    report.threads = threadCount;
+}
+
+void TradeReplay::replayText(string_view text) {
+    auto start = chrono::steady_clock::now();
+    if (netBought.size() < SymbolTable::size()) netBought.resize(SymbolTable::size(), 0);
+
+    // One chunk per thread, each ending on a line break
+    size_t chunkCount = min((size_t)threadCount, max((size_t)1, text.size() / MIN_CHUNK_BYTES));
+    vector<string_view> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i <= chunkCount && begin < text.size(); i++) {
+        size_t end = i == chunkCount ? text.size() : max(begin, text.size() / chunkCount * i);
+        while (end < text.size() && (end == 0 || text[end - 1] != '\n')) end++;
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    // Parse: SymbolTable::find only reads the table, so threads can share it
+    vector<ChunkTotals> totals(chunks.size());
+    runParallel(chunks.size(), [&](size_t c) {
+        ChunkTotals& chunk = totals[c];
+        chunk.partitions.resize(partitions.size());
+        chunk.netBought.assign(netBought.size(), 0);
+        TradeText trade;
+        DelimScanner::forEachRecord(chunks[c], [&](const DelimRecord& record) {
+            if (!TradeJournal::parseText(record, trade, SymbolTable::find) || trade.quantity <= 0) {
+                chunk.malformed++;
+            } else if (trade.symbol == SymbolTable::INVALID) {
+                chunk.unknownSymbols++;
+            } else {
+                addTrade(chunk.partitions[partitionOf(trade.user)], chunk.netBought,
+                         trade.user, trade.symbol, trade.side, trade.quantity, trade.price);
+                chunk.trades++;
+            }
+        });
+    });
+
+    // Merge: each partition's users are only ever touched by its own thread
+    runParallel(partitions.size(), [&](size_t p) {
+        for (ChunkTotals& chunk : totals) {
+            for (auto& entry : chunk.partitions[p]) {
+                mergeInto(partitions[p][entry.first], entry.second);
+            }
+        }
+    });
+
+    for (const ChunkTotals& chunk : totals) {
+        for (size_t s = 0; s < chunk.netBought.size(); s++) {
+            netBought[s] += chunk.netBought[s];
+        }
+        report.trades += chunk.trades;
+        report.malformed += chunk.malformed;
+        report.unknownSymbols += chunk.unknownSymbols;
+    }
+    report.seconds += secondsSince(start);
+}
+
+// The journal only holds trades since the last export, so one thread is enough
+void TradeReplay::replayJournal(const string& dir) {
+    auto start = chrono::steady_clock::now();
+    // Symbols the journal interns that nothing loaded knows end up past the
+    // end of netBought, and are counted as unknown
+    if (netBought.size() < SymbolTable::size()) netBought.resize(SymbolTable::size(), 0);
+
+    vector<string_view> nameOf;   // by journal user id, views into journalNames
+    TradeJournal::forEachTrade(dir, [&](const JournalTrade& t) {
+        if (t.quantity <= 0) {
+            report.malformed++;
+        } else if (t.symbol >= netBought.size()) {
+            report.unknownSymbols++;
+        } else {
+            if (t.userId >= nameOf.size()) nameOf.resize((size_t)t.userId + 1);
+            if (nameOf[t.userId].empty()) {
+                journalNames.emplace_back(t.user);
+                nameOf[t.userId] = journalNames.back();
+            }
+            string_view user = nameOf[t.userId];
+            addTrade(partitions[partitionOf(user)], netBought, user, t.symbol, t.side, t.quantity, t.price);
+            report.trades++;
+            report.journalTrades++;
+        }
+    });
+    report.seconds += secondsSince(start);
+}
+
+const ReplayedUser* TradeReplay::find(string_view user) const {
+    const auto& partition = partitions[partitionOf(user)];
+    auto it = partition.find(user);
+    return it == partition.end() ? nullptr : &it->second;
+}
+
+// Holdings and funding of one loaded user against their replayed totals
+// (null when the history never mentions them)
+static void compareUser(const User& user, string_view name, const ReplayedUser* totals, vector<string>& out) {
+    const PositionMap& actual = user.getPositions();
+    for (const Position& p : actual) {
+        int expected = totals ? totals->positions.quantity(p.symbol) : 0;
+        if (p.quantity != expected) {
+            out.push_back(string(name) + ": holds " + to_string(p.quantity) + " " + SymbolTable::name(p.symbol)
+                          + ", history gives " + to_string(expected));
+        }
+    }
+    if (totals) {
+        for (const Position& p : totals->positions) {
+            if (p.quantity != 0 && !actual.find(p.symbol)) {
+                out.push_back(string(name) + ": holds 0 " + SymbolTable::name(p.symbol)
+                              + ", history gives " + to_string(p.quantity));
+            }
+        }
+    }
+    Money deposited = user.getBalance() - (totals ? totals->cashFlow : Money());
+    if (deposited < Money()) {
+        out.push_back(string(name) + ": history pays in $" + (Money() - deposited).toString()
+                      + " more than the balance of $" + user.getBalance().toString());
+    }
+}
+
+AuditReport TradeReplay::verify(const UserDirectory& users, const vector<Stock*>& stocks) {
+    auto start = chrono::steady_clock::now();
+    size_t symbolCount = max(netBought.size(), SymbolTable::size());
+    netBought.resize(symbolCount, 0);
+
+    // Loaded users, filed under the same partitions as the replayed ones
+    vector<vector<pair<string, const User*>>> loadedByPartition(partitions.size());
+    users.forEach([&](uint32_t, const User& u) {
+        loadedByPartition[partitionOf(u.getName())].emplace_back(u.getName(), &u);
+    });
+
+    vector<vector<string>> issues(partitions.size());
+    vector<vector<int64_t>> held(partitions.size());
+    runParallel(partitions.size(), [&](size_t p) {
+        vector<string>& out = issues[p];
+        held[p].assign(symbolCount, 0);
+        unordered_map<string_view, const User*> loaded;
+        for (const auto& entry : loadedByPartition[p]) {
+            loaded.emplace(entry.first, entry.second);
+            for (const Position& pos : entry.second->getPositions()) {
+                held[p][pos.symbol] += pos.quantity;
+            }
+        }
+
+        for (const auto& entry : partitions[p]) {
+            auto it = loaded.find(entry.first);
+            if (it == loaded.end()) {
+                out.push_back(string(entry.first) + ": " + to_string(entry.second.trades)
+                              + " trade(s) in the history but no such user");
+            } else {
+                compareUser(*it->second, entry.first, &entry.second, out);
+            }
+        }
+        for (const auto& entry : loaded) {
+            if (partitions[p].find(entry.first) == partitions[p].end()) {
+                compareUser(*entry.second, entry.first, nullptr, out);
+            }
+        }
+    });
+
+    // Per-symbol inventory
+    report.symbols.clear();
+    vector<int> available(symbolCount, -1);
+    for (const Stock* s : stocks) {
+        available[s->symbol] = s->available;
+    }
+    vector<string> all;
+    for (SymbolId s = 0; s < symbolCount; s++) {
+        int64_t totalHeld = 0;
+        for (const vector<int64_t>& h : held) totalHeld += h[s];
+        if (available[s] < 0 && netBought[s] == 0 && totalHeld == 0) continue;
+        report.symbols.push_back({ s, netBought[s], totalHeld, available[s] });
+
+        const string& name = SymbolTable::name(s);
+        if (totalHeld != netBought[s]) {
+            all.push_back(name + ": users hold " + to_string(totalHeld) + " shares, history gives " + to_string(netBought[s]));
+        }
+        if (available[s] < 0 && netBought[s] != 0) {
+            all.push_back(name + ": traded but not a listed stock");
+        }
+    }
+
+    for (vector<string>& part : issues) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    sort(all.begin(), all.end());
+    report.issueCount = all.size();
+    if (all.size() > MAX_LISTED_ISSUES) all.resize(MAX_LISTED_ISSUES);
+    report.issues = move(all);
+
+    report.usersChecked = users.size();
+    report.usersReplayed = 0;
+    for (const auto& partition : partitions) {
+        report.usersReplayed += partition.size();
+    }
+    report.seconds += secondsSince(start);
+    return report;
+}
+
+void AuditReport::display() const {
+    ostringstream elapsed;
+    elapsed << fixed << setprecision(3) << seconds;
+
+    cout << "\n--- Trade History Audit ---\n";
+    cout << "Replayed " << trades << " trade(s)";
+    if (journalTrades > 0) {
+        cout << " (" << journalTrades << " from the journal)";
+    }
+    cout << " for " << usersReplayed << " user(s) on " << threads << " thread(s) in " << elapsed.str() << "s\n";
+    if (malformed > 0) {
+        cout << "Skipped " << malformed << " malformed trade(s).\n";
+    }
+    if (unknownSymbols > 0) {
+        cout << "Skipped " << unknownSymbols << " trade(s) in unknown symbols.\n";
+    }
+
+    cout << left << setw(10) << "Symbol" << right << setw(12) << "Replayed" << setw(12) << "Held" << setw(12) << "Available" << "\n";
+    for (const SymbolAudit& row : symbols) {
+        cout << left << setw(10) << SymbolTable::name(row.symbol) << right << setw(12) << row.replayed << setw(12) << row.held;
+        if (row.available < 0) cout << setw(12) << "-" << "\n";
+        else cout << setw(12) << row.available << "\n";
+    }
+    cout << left;
+
+    if (clean()) {
+        cout << "Audit passed: users and stocks match the trade history.\n";
+        return;
+    }
+    cout << "Audit found " << issueCount << " issue(s):\n";
+    for (const string& issue : issues) {
+        cout << "  - " << issue << "\n";
+    }
+    if (issueCount > issues.size()) {
+        cout << "  ... and " << issueCount - issues.size() << " more\n";
+    }
+}
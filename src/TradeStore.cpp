@@ -0,0 +1,241 @@
+#include "../include/TradeStore.h"
+#include "../include/DelimScanner.h"
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRADESTORE_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+TradeTotals& TradeTotals::operator+=(const TradeTotals& other) {
+    trades += other.trades;
+    buyVolume += other.buyVolume;
+    sellVolume += other.sellVolume;
+    notional += other.notional;
+    return *this;
+}
+
+void TradeStore::reserve(size_t rows) {
+    timestamps.reserve(rows);
+    userIds.reserve(rows);
+    symbols.reserve(rows);
+    sides.reserve(rows);
+    quantities.reserve(rows);
+    prices.reserve(rows);
+}
+
+void TradeStore::clear() {
+    timestamps.clear();
+    userIds.clear();
+    symbols.clear();
+    sides.clear();
+    quantities.clear();
+    prices.clear();
+}
+
+void TradeStore::append(int64_t timestampNs, uint32_t userId, SymbolId symbol, Side side, int quantity, Price price,
+                        bool maker) {
+    timestamps.push_back(timestampNs);
+    userIds.push_back(userId);
+    symbols.push_back(symbol);
+    sides.push_back((side == Side::Sell ? SELL : 0) | (maker ? MAKER : 0));
+    quantities.push_back(quantity);
+    prices.push_back(price.raw());
+}
+
+// Nanoseconds at 00:00 UTC of a YYYY-MM-DD date, or -1 if it is not one
+static int64_t parseDate(string_view date) {
+    int year, month, day;
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-') return -1;
+    if (!parseInt(date.substr(0, 4), year) || !parseInt(date.substr(5, 2), month) || !parseInt(date.substr(8, 2), day)) return -1;
+    if (month < 1 || month > 12 || day < 1 || day > 31) return -1;
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yearOfEra = y - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int64_t days = (int64_t)era * 146097 + dayOfEra - 719468;
+    return days * 86400 * 1000000000LL;
+}
+
+size_t TradeStore::loadText(string_view text, const function<uint32_t(string_view)>& userIdOf, size_t& skipped) {
+    size_t before = size();
+    reserve(before + DelimScanner::countLines(text) + 1);
+    TradeText trade;
+    DelimScanner::forEachRecord(text, [&](const DelimRecord& record) {
+        int64_t timestamp = -1;
+        if (TradeJournal::parseText(record, trade) && trade.quantity > 0) {
+            timestamp = parseDate(trade.date);
+        }
+        if (timestamp < 0) {
+            skipped++;
+            return;
+        }
+        append(timestamp, userIdOf(trade.user), trade.symbol, trade.side, trade.quantity, trade.price, trade.maker);
+    });
+    return size() - before;
+}
+
+size_t TradeStore::loadJournal(const string& dir, const function<uint32_t(string_view)>& userIdOf) {
+    size_t before = size();
+    TradeJournal::forEachTrade(dir, [&](const JournalTrade& t) {
+        if (t.quantity <= 0) return;
+        append(t.timestampNs, userIdOf(t.user), t.symbol, t.side, t.quantity, t.price, t.maker);
+    });
+    return size() - before;
+}
+
+static void totalsScalar(const int64_t* ts, const SymbolId* sym, const uint8_t* side, const int32_t* qty, const int64_t* price,
+                         size_t from, size_t to, SymbolId symbol, TimeRange range, TradeTotals& out) {
+    int64_t notional = 0;
+    for (size_t i = from; i < to; i++) {
+        if (sym[i] != symbol || (side[i] & TradeStore::MAKER) || !range.contains(ts[i])) continue;
+        out.trades++;
+        if (side[i] & TradeStore::SELL) out.sellVolume += qty[i];
+        else out.buyVolume += qty[i];
+        notional += qty[i] * price[i];
+    }
+    out.notional += Money::fromUnits(notional);
+}
+
+static void selectScalar(const int64_t* ts, size_t from, size_t to, TimeRange range, vector<uint32_t>& rows) {
+    for (size_t i = from; i < to; i++) {
+        if (range.contains(ts[i])) rows.push_back((uint32_t)i);
+    }
+}
+
+#ifdef TRADESTORE_HAVE_AVX2
+
+__attribute__((target("avx2")))
+static inline int64_t sumLanes(const __m256i& v) {
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256((__m256i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Four trades per step with every column widened to 64-bit lanes. A lane
+// that fails the symbol or time test, or is a maker's row, is zeroed by the
+// mask, so there are no branches in the loop.
+__attribute__((target("avx2")))
+static size_t totalsAvx2(const int64_t* ts, const SymbolId* sym, const uint8_t* side, const int32_t* qty, const int64_t* price,
+                         size_t count, SymbolId symbol, TimeRange range, TradeTotals& out) {
+    const __m256i want = _mm256_set1_epi64x((int64_t)symbol);
+    const __m256i from = _mm256_set1_epi64x(range.from);
+    const __m256i to = _mm256_set1_epi64x(range.to);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i sellBit = _mm256_set1_epi64x(TradeStore::SELL);
+    const __m256i makerBit = _mm256_set1_epi64x(TradeStore::MAKER);
+    __m256i trades = zero, buys = zero, sells = zero, notional = zero;
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i t = _mm256_loadu_si256((const __m256i*)(ts + i));
+        __m256i s = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(sym + i)));
+        __m256i q = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(qty + i)));
+        __m256i p = _mm256_loadu_si256((const __m256i*)(price + i));
+        int32_t sideBytes;
+        memcpy(&sideBytes, side + i, sizeof(sideBytes));
+        __m256i flags = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(sideBytes));
+        __m256i sell = _mm256_cmpeq_epi64(_mm256_and_si256(flags, sellBit), sellBit);
+        __m256i maker = _mm256_cmpeq_epi64(_mm256_and_si256(flags, makerBit), makerBit);
+
+        // from <= t < to, written without from - 1 so INT64_MIN works
+        __m256i inRange = _mm256_andnot_si256(_mm256_cmpgt_epi64(from, t), _mm256_cmpgt_epi64(to, t));
+        __m256i mask = _mm256_andnot_si256(maker, _mm256_and_si256(_mm256_cmpeq_epi64(s, want), inRange));
+        __m256i hit = _mm256_and_si256(mask, q);
+
+        trades = _mm256_sub_epi64(trades, mask);   // mask lanes are -1
+        sells = _mm256_add_epi64(sells, _mm256_and_si256(sell, hit));
+        buys = _mm256_add_epi64(buys, _mm256_andnot_si256(sell, hit));
+        // No 64x64 multiply in AVX2: quantity (positive, 32-bit) times each
+        // 32-bit half of the price, recombined modulo 2^64
+        __m256i low = _mm256_mul_epu32(hit, p);
+        __m256i high = _mm256_slli_epi64(_mm256_mul_epu32(hit, _mm256_srli_epi64(p, 32)), 32);
+        notional = _mm256_add_epi64(notional, _mm256_add_epi64(low, high));
+    }
+
+    out.trades += (uint64_t)sumLanes(trades);
+    out.buyVolume += sumLanes(buys);
+    out.sellVolume += sumLanes(sells);
+    out.notional += Money::fromUnits(sumLanes(notional));
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t selectAvx2(const int64_t* ts, size_t count, TimeRange range, vector<uint32_t>& rows) {
+    const __m256i from = _mm256_set1_epi64x(range.from);
+    const __m256i to = _mm256_set1_epi64x(range.to);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i t = _mm256_loadu_si256((const __m256i*)(ts + i));
+        __m256i inRange = _mm256_andnot_si256(_mm256_cmpgt_epi64(from, t), _mm256_cmpgt_epi64(to, t));
+        unsigned bits = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(inRange));
+        while (bits) {
+            rows.push_back((uint32_t)(i + __builtin_ctz(bits)));
+            bits &= bits - 1;
+        }
+    }
+    return i;
+}
+
+static bool cpuHasAvx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+#endif
+
+TradeTotals TradeStore::totals(SymbolId symbol, TimeRange range) const {
+    TradeTotals out;
+    size_t done = 0;
+#ifdef TRADESTORE_HAVE_AVX2
+    if (cpuHasAvx2()) {
+        done = totalsAvx2(timestamps.data(), symbols.data(), sides.data(), quantities.data(), prices.data(),
+                          size(), symbol, range, out);
+    }
+#endif
+    totalsScalar(timestamps.data(), symbols.data(), sides.data(), quantities.data(), prices.data(),
+                 done, size(), symbol, range, out);
+    return out;
+}
+
+// A scatter into per-symbol sums: no gather/scatter trick beats the plain
+// loop here, but it still reads only the four columns it needs, once
+void TradeStore::totalsBySymbol(vector<TradeTotals>& out, TimeRange range) const {
+    out.assign(SymbolTable::size(), TradeTotals());
+    vector<int64_t> notional(out.size(), 0);
+    bool everything = range.from == INT64_MIN && range.to == INT64_MAX;
+    for (size_t i = 0; i < size(); i++) {
+        if (!everything && !range.contains(timestamps[i])) continue;
+        SymbolId s = symbols[i];
+        if (s >= out.size() || (sides[i] & MAKER)) continue;
+        TradeTotals& t = out[s];
+        t.trades++;
+        if (sides[i] & SELL) t.sellVolume += quantities[i];
+        else t.buyVolume += quantities[i];
+        notional[s] += quantities[i] * prices[i];
+    }
+    for (size_t s = 0; s < out.size(); s++) {
+        out[s].notional = Money::fromUnits(notional[s]);
+    }
+}
+
+void TradeStore::selectRange(TimeRange range, vector<uint32_t>& rows) const {
+    rows.clear();
+    size_t done = 0;
+#ifdef TRADESTORE_HAVE_AVX2
+    if (cpuHasAvx2()) {
+        done = selectAvx2(timestamps.data(), size(), range, rows);
+    }
+#endif
+    selectScalar(timestamps.data(), done, size(), range, rows);
+}
+
+const char* TradeStore::implementation() {
+#ifdef TRADESTORE_HAVE_AVX2
+    if (cpuHasAvx2()) return "avx2";
+#endif
+    return "scalar";
+}
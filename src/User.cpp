@@ -1,100 +1,196 @@
 #include "../include/User.h"
-#include <sstream>
+#include "../include/Log.h"
+#include <stdexcept>
 
 int User::totalUsers = 0;
+vector<User*> User::dirtyUsers;
+AccountListener* User::listener = nullptr;
 
 User::User() {
     name = "Unknown";
-    balance = 0.0;
+    balance = Money();
+    reserved = Money();
+    dirty = false;
     totalUsers++;
 }
 
-User::User(string userName, double initialBalance) {
+User::User(string userName, Money initialBalance) {
     name = userName;
     balance = initialBalance;
+    reserved = Money();
+    dirty = false;
     totalUsers++;
 }
 
+// A copy is a separate account: counted, and not on the dirty list until it changes
+User::User(const User& other)
+    : name(other.name), balance(other.balance), reserved(other.reserved), positions(other.positions) {
+    dirty = false;
+    totalUsers++;
+}
+
+// Keeps this account's own place on the dirty list
+User& User::operator=(const User& other) {
+    name = other.name;
+    balance = other.balance;
+    reserved = other.reserved;
+    positions = other.positions;
+    return *this;
+}
+
+User::User(string userName, double initialBalance) : User(userName, Money::fromDouble(initialBalance)) {
+}
+
 User::~User() {
+    if (dirty) {
+        for (size_t i = 0; i < dirtyUsers.size(); i++) {
+            if (dirtyUsers[i] == this) {
+                dirtyUsers[i] = dirtyUsers.back();
+                dirtyUsers.pop_back();
+                break;
+            }
+        }
+    }
     totalUsers--;
-    cout << "User " << name << " deleted\n";
+    LOG_DEBUG("User {} deleted\n", name);
+}
+
+void User::changeBalance(Money delta) {
+    balance += delta;
+    if (listener) listener->onCashChange(*this, delta);
+}
+
+void User::notifyFill(SymbolId symbol, int shares, Price price) {
+    if (listener) listener->onFill(*this, symbol, shares, price);
 }
 
-void User::addBalance(double amount) {
-    balance += amount;
-    cout << "Added " << amount << " to account\n";
+void User::addBalance(Money amount) {
+    changeBalance(amount);
+    markDirty();
+    LOG_INFO("Added {} to account\n", amount);
 }
 
-bool User::buyStock(string symbol, int quantity, double price) {
-    double totalCost = quantity * price;
+bool User::buyStock(SymbolId symbol, int quantity, Price price) {
+    Money totalCost = price * quantity;
     
-    if (balance >= totalCost) {
-        balance -= totalCost;
+    if (getAvailableCash() >= totalCost) {
+        changeBalance(-totalCost);
         
-        // Check if stock already exists in portfolio
-        bool found = false;
-        for (auto& s : stocks) {
-            if (s.first == symbol) {
-                s.second += quantity;
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            stocks.push_back({symbol, quantity});
-        }
+        positions.findOrInsert(symbol).quantity += quantity;
+        notifyFill(symbol, quantity, price);
+        markDirty();
         
-        cout << "Bought " << quantity << " shares of " << symbol << "\n";
+        LOG_INFO("Bought {} shares of {}\n", quantity, SymbolTable::name(symbol));
         return true;
     }
     
-    cout << "Insufficient balance\n";
+    LOG_WARN("Insufficient balance\n");
     return false;
 }
 
-bool User::sellStock(string symbol, int quantity, double price) {
-    double totalAmount = quantity * price;
-    balance += totalAmount;
+bool User::sellStock(SymbolId symbol, int quantity, Price price) {
+    Position* held = positions.find(symbol);
+    if (!held || held->quantity - held->reserved < quantity) {
+        LOG_WARN("Insufficient shares\n");
+        return false;
+    }
+    changeBalance(price * quantity);
     
     // Remove stock from portfolio
-    for (auto& s : stocks) {
-        if (s.first == symbol) {
-            s.second -= quantity;
-            if (s.second <= 0) {
-                stocks.erase(stocks.begin() + (&s - &stocks[0]));
-            }
-            break;
-        }
+    held->quantity -= quantity;
+    if (held->quantity == 0) {
+        positions.erase(symbol);
     }
+    notifyFill(symbol, -quantity, price);
     
-    cout << "Sold " << quantity << " shares of " << symbol << "\n";
+    markDirty();
+    LOG_INFO("Sold {} shares of {}\n", quantity, SymbolTable::name(symbol));
+    return true;
+}
+
+// Reservations change what is free, not what is held, so they neither
+// mark the account dirty nor reach the listener
+bool User::reserveCash(Money amount) {
+    if (balance - reserved < amount) {
+        return false;
+    }
+    reserved += amount;
+    return true;
+}
+
+void User::releaseCash(Money amount) {
+    reserved -= amount;
+}
+
+bool User::reserveShares(SymbolId symbol, int quantity) {
+    Position* held = positions.find(symbol);
+    if (!held || held->quantity - held->reserved < quantity) {
+        return false;
+    }
+    held->reserved += quantity;
     return true;
 }
 
+void User::releaseShares(SymbolId symbol, int quantity) {
+    Position* held = positions.find(symbol);
+    if (held) held->reserved -= quantity;
+}
+
+void User::settleBuy(SymbolId symbol, int quantity, Price price, Price limit) {
+    reserved -= limit * quantity;
+    changeBalance(-(price * quantity));
+    positions.findOrInsert(symbol).quantity += quantity;
+    notifyFill(symbol, quantity, price);
+    markDirty();
+    LOG_INFO("Bought {} shares of {}\n", quantity, SymbolTable::name(symbol));
+}
+
+void User::settleSell(SymbolId symbol, int quantity, Price price) {
+    Position* held = positions.find(symbol);
+    if (held) {
+        held->quantity -= quantity;
+        held->reserved -= quantity;
+        if (held->quantity == 0) {
+            positions.erase(symbol);
+        }
+    }
+    changeBalance(price * quantity);
+    notifyFill(symbol, -quantity, price);
+    markDirty();
+    LOG_INFO("Sold {} shares of {}\n", quantity, SymbolTable::name(symbol));
+}
+
 void User::viewPortfolio() const {
     cout << "\n--- Portfolio of " << name << " ---\n";
     cout << "Balance: $" << balance << "\n";
-    cout << "Stocks owned: " << stocks.size() << "\n";
+    if (reserved > Money()) {
+        cout << "Reserved for open buy orders: $" << reserved << "\n";
+    }
+    cout << "Stocks owned: " << positions.size() << "\n";
     
-    if (stocks.empty()) {
+    if (positions.empty()) {
         cout << "No stocks in portfolio.\n";
     } else {
-        for (size_t i = 0; i < stocks.size(); i++) {
-            cout << i + 1 << ". " << stocks[i].first << " x" << stocks[i].second << "\n";
+        for (size_t i = 0; i < positions.size(); i++) {
+            cout << i + 1 << ". " << SymbolTable::name(positions[i].symbol) << " x" << positions[i].quantity;
+            if (positions[i].reserved > 0) {
+                cout << " (" << positions[i].reserved << " in open sell orders)";
+            }
+            cout << "\n";
         }
     }
 }
 
-string User::getName() const {
+const string& User::getName() const {
     return name;
 }
 
-double User::getBalance() const {
+Money User::getBalance() const {
     return balance;
 }
 
-vector<pair<string, int>>& User::getStocks() {
-    return stocks;
+const PositionMap& User::getPositions() const {
+    return positions;
 }
 
 int User::getTotalUsers() {
@@ -105,44 +201,75 @@ void User::displayStats() {
     cout << "Total users in system: " << totalUsers << "\n";
 }
 
-void User::recordTransaction(string symbol, int qty, double amount) {
-    cout << "Transaction recorded: " << symbol << " x" << qty << " = " << amount << "\n";
+void User::markDirty() {
+    if (!dirty) {
+        dirty = true;
+        dirtyUsers.push_back(this);
+    }
+}
+
+void User::clearDirtyUsers() {
+    for (User* u : dirtyUsers) {
+        u->dirty = false;
+    }
+    dirtyUsers.clear();
+}
+
+void User::recordTransaction(SymbolId symbol, int qty, Money amount) {
+    LOG_INFO("Transaction recorded: {} x{} = {}\n", SymbolTable::name(symbol), qty, amount);
 }
 
 void User::saveToFile(ofstream& file) const {
     file << name << "|" << balance << "|";
-    for (size_t i = 0; i < stocks.size(); i++) {
-        file << stocks[i].first << ":" << stocks[i].second;
-        if (i < stocks.size() - 1) file << ",";
+    for (size_t i = 0; i < positions.size(); i++) {
+        file << SymbolTable::name(positions[i].symbol) << ":" << positions[i].quantity;
+        if (i < positions.size() - 1) file << ",";
     }
     file << "\n";
 }
 
-User User::loadFromFile(string line) {
-    stringstream ss(line);
-    string name, balanceStr, stocksStr;
-    double balance;
-    
-    getline(ss, name, '|');
-    getline(ss, balanceStr, '|');
-    getline(ss, stocksStr, '|');
-    
-    balance = stod(balanceStr);
-    User u(name, balance);
-    
-    if (!stocksStr.empty()) {
-        stringstream stockStream(stocksStr);
-        string stock;
-        while (getline(stockStream, stock, ',')) {
-            stringstream stockData(stock);
-            string symbol;
-            string qty;
-            getline(stockData, symbol, ':');
-            getline(stockData, qty);
-            u.stocks.push_back({symbol, stoi(qty)});
+User User::loadFromFile(string_view line) {
+    uint32_t delims[256];
+    vector<uint32_t> longLine;
+    uint32_t* index = delims;
+    if (line.size() > 256) {
+        longLine.resize(line.size());
+        index = longLine.data();
+    }
+    DelimRecord record = { line.data(), line.size(), index, DelimScanner::scan(line.data(), line.size(), index) };
+    return loadFromRecord(record);
+}
+
+User User::loadFromRecord(const DelimRecord& record) {
+    if (record.count == 0 || record.delimAt(0) != '|' || (record.count > 1 && record.delimAt(1) != '|')) {
+        throw invalid_argument("Malformed user record: " + string(record.line()));
+    }
+    User u(string(record.field(0)), Money::parse(record.field(1)));
+
+    // Holdings follow the second '|' as SYM:qty pairs separated by ','
+    if (record.count > 2) {
+        u.positions.reserve((record.count - 1) / 2);
+    }
+    size_t i = 2;
+    while (record.count >= 2) {
+        if (i < record.count && record.delimAt(i) == ':') {
+            int qty = 0;
+            if (!parseInt(record.field(i + 1), qty)) {
+                throw invalid_argument("Invalid holding quantity: " + string(record.field(i + 1)));
+            }
+            // A symbol listed twice is merged into one position
+            u.positions.findOrInsert(SymbolTable::intern(record.field(i))).quantity += qty;
+            if (i + 1 >= record.count || record.delimAt(i + 1) != ',') break;
+            i += 2;
+        } else {
+            // Anything left that is not a SYM:qty pair must be empty
+            if (!record.field(i).empty()) {
+                throw invalid_argument("Malformed holding: " + string(record.field(i)));
+            }
+            break;
         }
     }
-    
+
     return u;
 }
 
@@ -151,8 +278,9 @@ ostream& operator<<(ostream& os, const User& u) {
     return os;
 }
 
-User& User::operator+=(double amount) noexcept {
-    balance += amount;
+User& User::operator+=(Money amount) noexcept {
+    changeBalance(amount);
+    markDirty();
     return *this;
 }
 
@@ -0,0 +1,135 @@
+#include "../include/UserDirectory.h"
+
+UserDirectory::UserDirectory() {
+    slotCount = 0;
+    freeHead = EMPTY;
+    liveCount = 0;
+}
+
+UserDirectory::~UserDirectory() {
+    clear();
+}
+
+void UserDirectory::clear() {
+    forEach([](uint32_t, User& user) { user.~User(); });
+    // Generations carry on, so handles from before stay stale
+    for (auto& chunk : chunks) {
+        for (uint32_t i = 0; i < CHUNK_SIZE; i++) {
+            if (chunk[i].generation & 1) chunk[i].generation++;
+            chunk[i].nextFree = EMPTY;
+        }
+    }
+    for (IndexSlot& s : index) s.id = EMPTY;
+    slotCount = 0;
+    freeHead = EMPTY;
+    liveCount = 0;
+}
+
+void UserDirectory::addChunk() {
+    Slot* chunk = new Slot[CHUNK_SIZE];
+    for (uint32_t i = 0; i < CHUNK_SIZE; i++) {
+        chunk[i].nextFree = EMPTY;
+        chunk[i].generation = 0;
+    }
+    chunks.emplace_back(chunk);
+}
+
+uint32_t UserDirectory::takeSlot() {
+    if (freeHead != EMPTY) return freeHead;
+    if (slotCount == EMPTY) {
+        throw runtime_error("User directory is full");
+    }
+    if ((slotCount >> CHUNK_BITS) == chunks.size()) addChunk();
+    return slotCount;
+}
+
+size_t UserDirectory::findIndexSlot(string_view name, uint32_t h) const {
+    size_t mask = index.size() - 1;
+    for (size_t i = h & mask; ; i = (i + 1) & mask) {
+        const IndexSlot& s = index[i];
+        if (s.id == EMPTY) return i;
+        if (s.hash == h && objectIn(slotAt(s.id))->getName() == name) return i;
+    }
+}
+
+void UserDirectory::rehash(size_t size) {
+    size_t wanted = 16;
+    while (wanted < size) wanted *= 2;
+    vector<IndexSlot> old(wanted, IndexSlot{ 0, EMPTY });
+    old.swap(index);
+    // Names are unique, so entries go to the first free slot of their run
+    size_t mask = index.size() - 1;
+    for (const IndexSlot& s : old) {
+        if (s.id == EMPTY) continue;
+        size_t i = s.hash & mask;
+        while (index[i].id != EMPTY) i = (i + 1) & mask;
+        index[i] = s;
+    }
+}
+
+void UserDirectory::eraseIndex(size_t hole) {
+    // Backward-shift deletion, as in PositionMap::erase
+    size_t mask = index.size() - 1;
+    index[hole].id = EMPTY;
+    for (size_t i = (hole + 1) & mask; index[i].id != EMPTY; i = (i + 1) & mask) {
+        size_t want = index[i].hash & mask;
+        if (((i - want) & mask) >= ((i - hole) & mask)) {
+            index[hole] = index[i];
+            index[i].id = EMPTY;
+            hole = i;
+        }
+    }
+}
+
+bool UserDirectory::remove(UserHandle handle) {
+    User* user = get(handle);
+    if (!user) return false;
+    const string& name = user->getName();
+    eraseIndex(findIndexSlot(name, hashName(name)));
+    user->~User();
+
+    Slot& slot = slotAt(handle.index);
+    slot.generation++;
+    slot.nextFree = freeHead;
+    freeHead = handle.index;
+    liveCount--;
+    return true;
+}
+
+User* UserDirectory::get(UserHandle handle) const {
+    if (handle.index >= slotCount) return nullptr;
+    Slot& slot = slotAt(handle.index);
+    return slot.generation == handle.generation && (slot.generation & 1) ? objectIn(slot) : nullptr;
+}
+
+User* UserDirectory::find(uint32_t id) const {
+    return get(handleOf(id));
+}
+
+User* UserDirectory::find(string_view name) const {
+    return get(handleOf(name));
+}
+
+UserHandle UserDirectory::handleOf(uint32_t id) const {
+    if (id >= slotCount) return UserHandle::none();
+    return { id, slotAt(id).generation };
+}
+
+UserHandle UserDirectory::handleOf(string_view name) const {
+    if (index.empty()) return UserHandle::none();
+    const IndexSlot& s = index[findIndexSlot(name, hashName(name))];
+    return s.id == EMPTY ? UserHandle::none() : handleOf(s.id);
+}
+
+uint32_t UserDirectory::idOf(const User& user) const {
+    return handleOf(user.getName()).index;
+}
+
+void UserDirectory::reserve(size_t count) {
+    if (count >= EMPTY) {
+        throw invalid_argument("Too many users for the directory");
+    }
+    while (chunks.size() * CHUNK_SIZE < count) addChunk();
+    size_t wanted = count + count / 3 + 1;
+    if (wanted > index.size()) rehash(wanted);
+}
@@ -0,0 +1,117 @@
+#include "../include/Valuation.h"
+
+void Valuation::ensureSymbol(SymbolId symbol) {
+    if (symbol < marks.size()) return;
+    size_t count = max((size_t)symbol + 1, SymbolTable::size());
+    holders.resize(count);
+    marks.resize(count, Price());
+    sharesHeld.resize(count, 0);
+}
+
+void Valuation::addShares(uint32_t account, SymbolId symbol, int quantity, Price price) {
+    ensureSymbol(symbol);
+    if (marks[symbol] == Price()) onPriceChange(symbol, price);
+
+    vector<Holding>& list = holders[symbol];
+    auto slot = slotOf.find(slotKey(account, symbol));
+    if (slot == slotOf.end()) {
+        slot = slotOf.emplace(slotKey(account, symbol), (uint32_t)list.size()).first;
+        list.push_back({ account, 0, Money() });
+    }
+    Holding& h = list[slot->second];
+    Money cost = price * quantity;
+    Money value = marks[symbol] * quantity;
+    h.quantity += quantity;
+    h.cost += cost;
+    accounts[account].cost += cost;
+    accounts[account].marketValue += value;
+    costTotal += cost;
+    marketValueTotal += value;
+    sharesHeld[symbol] += quantity;
+}
+
+void Valuation::removeShares(uint32_t account, SymbolId symbol, int quantity) {
+    if (symbol >= holders.size()) return;
+    auto slot = slotOf.find(slotKey(account, symbol));
+    if (slot == slotOf.end()) return;
+    vector<Holding>& list = holders[symbol];
+    Holding& h = list[slot->second];
+
+    // Never more than is held: User refuses those sales
+    int sold = min(quantity, h.quantity);
+    Money cost = sold == h.quantity ? h.cost : h.cost.mulDiv(sold, h.quantity);
+    Money value = marks[symbol] * sold;
+    h.quantity -= sold;
+    h.cost -= cost;
+    accounts[account].cost -= cost;
+    accounts[account].marketValue -= value;
+    costTotal -= cost;
+    marketValueTotal -= value;
+    sharesHeld[symbol] -= sold;
+
+    if (h.quantity == 0) {
+        // Swap the last holder into the hole and repoint its slot
+        uint32_t index = slot->second;
+        slotOf.erase(slot);
+        if (index + 1 != list.size()) {
+            list[index] = list.back();
+            slotOf[slotKey(list[index].account, symbol)] = index;
+        }
+        list.pop_back();
+    }
+}
+
+const Valuation::Account* Valuation::find(const User& user) const {
+    auto it = accountOf.find(&user);
+    return it == accountOf.end() ? nullptr : &accounts[it->second];
+}
+
+void Valuation::track(User& user) {
+    if (accountOf.count(&user)) return;
+    uint32_t account = (uint32_t)accounts.size();
+    accounts.push_back({ &user, Money(), Money() });
+    accountOf.emplace(&user, account);
+    cashTotal += user.getBalance();
+    for (const Position& p : user.getPositions()) {
+        if (p.quantity > 0) addShares(account, p.symbol, p.quantity, mark(p.symbol));
+    }
+}
+
+void Valuation::onCashChange(User& user, Money delta) {
+    if (accountOf.count(&user)) cashTotal += delta;
+}
+
+void Valuation::onFill(User& user, SymbolId symbol, int shares, Price price) {
+    auto it = accountOf.find(&user);
+    if (it == accountOf.end()) return;
+    if (shares > 0) addShares(it->second, symbol, shares, price);
+    else removeShares(it->second, symbol, -shares);
+}
+
+void Valuation::onPriceChange(SymbolId symbol, Price price) {
+    ensureSymbol(symbol);
+    Price change = price - marks[symbol];
+    marks[symbol] = price;
+    if (change == Price()) return;
+    for (const Holding& h : holders[symbol]) {
+        accounts[h.account].marketValue += change * h.quantity;
+    }
+    marketValueTotal += change * sharesHeld[symbol];
+}
+
+Money Valuation::marketValue(const User& user) const {
+    const Account* a = find(user);
+    return a ? a->marketValue : Money();
+}
+
+Money Valuation::costBasis(const User& user) const {
+    const Account* a = find(user);
+    return a ? a->cost : Money();
+}
+
+const Holding* Valuation::holding(const User& user, SymbolId symbol) const {
+    auto it = accountOf.find(&user);
+    if (it == accountOf.end() || symbol >= holders.size()) return nullptr;
+    auto slot = slotOf.find(slotKey(it->second, symbol));
+    return slot == slotOf.end() ? nullptr : &holders[symbol][slot->second];
+}